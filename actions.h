@@ -0,0 +1,410 @@
+// actions.h
+// Action engine: chords, tap/hold, turbo and macros
+// Sits between the button bits and the output sink for the buttons that
+// have an action (see ActionsMapping in keymapping.h); every other button
+// keeps the mapper's plain, immediate key. Everything timed runs on a
+// TimerWheel advanced by the owner's clock, so the same input at the same
+// times always gives the same output, live or replayed.
+//
+// Chords: a button that is part of a chord waits up to chord_window_ms for
+// the rest of it. If the chord completes in time, the chord's action runs
+// and its buttons do nothing else until released; otherwise each button
+// acts alone once its window runs out (or right away if it is released).
+// Buttons that aren't in any chord never wait. The first chord in the list
+// that is completely held wins.
+
+#ifndef ACTIONS_H
+#define ACTIONS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "keymapping.h"
+#include "output_sink.h"
+#include "timer_wheel.h"
+#include "timing.h"
+
+// Taps hold the key this long: some games miss shorter presses, and a press
+// and release in the same frame would be reordered by the batch sink
+#define ACTION_TAP_NS       (20 * NS_PER_MS)
+
+#define ACTION_BUTTONS      16          // Bits of GipInputPacket.buttons
+
+// An ActionsMapping prepared for the engine (part of CompiledMapping)
+typedef struct {
+    ActionMapping list[ACTION_MAX];
+    uint8_t count;
+    uint64_t chord_window_ns;
+    uint16_t engine_mask;               // Buttons routed through the engine
+    uint16_t chord_mask;                // Buttons that are part of a chord
+    int8_t single[ACTION_BUTTONS];      // Action of each button alone, -1 = plain key
+    uint16_t plain_keys[ACTION_BUTTONS];
+    uint16_t plain_mask;                // Buttons with a plain key
+    uint8_t chords[ACTION_MAX];         // Indices of the chord actions, in list order
+    uint8_t chord_count;
+} CompiledActions;
+
+static inline void compile_actions(CompiledActions *ca, const ActionsMapping *actions,
+                                   const uint16_t plain_keys[ACTION_BUTTONS],
+                                   uint16_t plain_mask) {
+    memset(ca, 0, sizeof(*ca));
+    ca->count = actions->count < ACTION_MAX ? actions->count : ACTION_MAX;
+    memcpy(ca->list, actions->list, sizeof(ActionMapping) * ca->count);
+    ca->chord_window_ns = (uint64_t)actions->chord_window_ms * NS_PER_MS;
+    memcpy(ca->plain_keys, plain_keys, sizeof(ca->plain_keys));
+    ca->plain_mask = plain_mask;
+    memset(ca->single, -1, sizeof(ca->single));
+
+    for (int i = 0; i < ca->count; i++) {
+        uint16_t buttons = ca->list[i].buttons;
+        if (buttons == 0) {
+            continue;
+        }
+        if (buttons & (buttons - 1)) {
+            ca->chords[ca->chord_count++] = (uint8_t)i;
+            ca->chord_mask |= buttons;
+        } else {
+            ca->single[__builtin_ctz(buttons)] = (int8_t)i;   // The last one wins
+        }
+        ca->engine_mask |= buttons;
+    }
+}
+
+// What a button is doing
+typedef enum {
+    BUTTON_IDLE,
+    BUTTON_PENDING,         // Pressed, waiting to see if a chord completes
+    BUTTON_SINGLE,          // Acting alone
+    BUTTON_TAPPING,         // Released while pending: acting alone for one tap
+    BUTTON_CHORD            // Consumed by a chord
+} ButtonPhase;
+
+typedef struct {
+    TimerNode timer;
+    bool running;           // Started and not finished
+    bool held;              // Its button(s) are still held
+    bool hold_fired;        // TAP_HOLD: held long enough, hold_key is down
+    bool tapping;           // TAP_HOLD: tap key down until the timer fires
+    bool key_down;          // TURBO/MACRO: the current key is down
+    uint8_t step;           // MACRO
+} ActionRun;
+
+typedef struct {
+    const CompiledActions *map;
+    OutputSink *sink;
+    bool *keys;                         // The mapper's key state
+    TimerWheel wheel;
+    uint64_t now_ns;
+
+    uint8_t phase[ACTION_BUTTONS];
+    uint8_t chord_of[ACTION_BUTTONS];   // BUTTON_CHORD: the chord's action
+    TimerNode window[ACTION_BUTTONS];   // Chord window, then the tap of a tapped button
+    ActionRun runs[ACTION_MAX];
+} ActionEngine;
+
+static inline void action_key(ActionEngine *e, uint16_t key, bool pressed) {
+    if (key == ACTION_NO_KEY || key > 0xFF) {
+        return;
+    }
+    sink_key(e->sink, key, pressed);
+    e->keys[key] = pressed;
+}
+
+// ============================================================================
+// Actions
+// ============================================================================
+
+static inline void action_macro_step(ActionEngine *e, int index, uint64_t at_ns) {
+    const ActionMapping *a = &e->map->list[index];
+    ActionRun *run = &e->runs[index];
+    const MacroStep *step = &a->steps[run->step];
+    action_key(e, step->key, true);
+    run->key_down = true;
+    timer_wheel_schedule(&e->wheel, &run->timer,
+                         at_ns + (uint64_t)(step->hold_ms ? step->hold_ms : 1) * NS_PER_MS);
+}
+
+static inline uint64_t action_turbo_half_period(const ActionMapping *a) {
+    return NS_PER_SEC / 2 / (a->rate_hz ? a->rate_hz : 10);
+}
+
+// The button(s) of action index went down
+static inline void action_start(ActionEngine *e, int index, uint64_t at_ns) {
+    const ActionMapping *a = &e->map->list[index];
+    ActionRun *run = &e->runs[index];
+    if (run->running && a->type == ACTION_MACRO) {
+        run->held = true;       // A macro plays to the end; pressing again does nothing
+        return;
+    }
+    if (run->running && a->type == ACTION_TAP_HOLD && run->tapping) {
+        // Pressed again before the last tap ended: end it now
+        timer_wheel_cancel(&e->wheel, &run->timer);
+        action_key(e, a->key, false);
+    }
+    run->running = true;
+    run->held = true;
+    run->hold_fired = false;
+    run->tapping = false;
+
+    switch (a->type) {
+        case ACTION_KEY:
+            action_key(e, a->key, true);
+            break;
+        case ACTION_TAP_HOLD:
+            timer_wheel_schedule(&e->wheel, &run->timer, at_ns + (uint64_t)a->hold_ms * NS_PER_MS);
+            break;
+        case ACTION_TURBO:
+            action_key(e, a->key, true);
+            run->key_down = true;
+            timer_wheel_schedule(&e->wheel, &run->timer, at_ns + action_turbo_half_period(a));
+            break;
+        case ACTION_MACRO:
+            run->step = 0;
+            if (a->step_count == 0) {
+                run->running = false;
+                break;
+            }
+            action_macro_step(e, index, at_ns);
+            break;
+    }
+}
+
+// The button(s) of action index were released
+static inline void action_end(ActionEngine *e, int index, uint64_t at_ns) {
+    const ActionMapping *a = &e->map->list[index];
+    ActionRun *run = &e->runs[index];
+    if (!run->running || !run->held) {
+        return;
+    }
+    run->held = false;
+
+    switch (a->type) {
+        case ACTION_KEY:
+            action_key(e, a->key, false);
+            run->running = false;
+            break;
+        case ACTION_TAP_HOLD:
+            if (run->hold_fired) {
+                action_key(e, a->hold_key, false);
+                run->running = false;
+            } else {
+                // Released in time: a tap
+                action_key(e, a->key, true);
+                run->tapping = true;
+                timer_wheel_schedule(&e->wheel, &run->timer, at_ns + ACTION_TAP_NS);
+            }
+            break;
+        case ACTION_TURBO:
+            timer_wheel_cancel(&e->wheel, &run->timer);
+            if (run->key_down) {
+                action_key(e, a->key, false);
+                run->key_down = false;
+            }
+            run->running = false;
+            break;
+        case ACTION_MACRO:
+            break;              // Keeps playing
+    }
+}
+
+// Each timer's events are a frame of their own (button changes are flushed
+// with their packet by the mapper), so an advance that runs several turbo
+// toggles at once never puts a press and release of one key in one frame
+static inline void action_timer_fired(TimerNode *node) {
+    ActionEngine *e = (ActionEngine *)node->owner;
+    int index = node->arg;
+    const ActionMapping *a = &e->map->list[index];
+    ActionRun *run = &e->runs[index];
+    uint64_t at_ns = node->deadline_ns;
+
+    switch (a->type) {
+        case ACTION_KEY:
+            break;
+        case ACTION_TAP_HOLD:
+            if (run->tapping) {
+                action_key(e, a->key, false);
+                run->tapping = false;
+                run->running = false;
+            } else if (run->held) {
+                action_key(e, a->hold_key, true);
+                run->hold_fired = true;
+            }
+            break;
+        case ACTION_TURBO:
+            run->key_down = !run->key_down;
+            action_key(e, a->key, run->key_down);
+            timer_wheel_schedule(&e->wheel, &run->timer, at_ns + action_turbo_half_period(a));
+            break;
+        case ACTION_MACRO:
+            if (run->key_down) {
+                action_key(e, a->steps[run->step].key, false);
+                run->key_down = false;
+            }
+            if (++run->step < a->step_count) {
+                action_macro_step(e, index, at_ns);
+            } else {
+                run->running = false;
+            }
+            break;
+    }
+    sink_flush(e->sink);
+}
+
+// ============================================================================
+// Buttons
+// ============================================================================
+
+static inline void action_single_start(ActionEngine *e, int bit, uint64_t at_ns) {
+    int index = e->map->single[bit];
+    if (index >= 0) {
+        action_start(e, index, at_ns);
+    } else if (e->map->plain_mask & (1u << bit)) {
+        action_key(e, e->map->plain_keys[bit], true);
+    }
+}
+
+static inline void action_single_end(ActionEngine *e, int bit, uint64_t at_ns) {
+    int index = e->map->single[bit];
+    if (index >= 0) {
+        action_end(e, index, at_ns);
+    } else if (e->map->plain_mask & (1u << bit)) {
+        action_key(e, e->map->plain_keys[bit], false);
+    }
+}
+
+// Chord window over (button still held), or the tap of a tapped button done
+static inline void action_window_fired(TimerNode *node) {
+    ActionEngine *e = (ActionEngine *)node->owner;
+    int bit = node->arg;
+    if (e->phase[bit] == BUTTON_PENDING) {
+        e->phase[bit] = BUTTON_SINGLE;
+        action_single_start(e, bit, node->deadline_ns);
+    } else if (e->phase[bit] == BUTTON_TAPPING) {
+        e->phase[bit] = BUTTON_IDLE;
+        action_single_end(e, bit, node->deadline_ns);
+    }
+    sink_flush(e->sink);
+}
+
+// Start the first chord whose buttons are all pending
+static inline void action_check_chords(ActionEngine *e) {
+    uint16_t pending = 0;
+    for (int bit = 0; bit < ACTION_BUTTONS; bit++) {
+        if (e->phase[bit] == BUTTON_PENDING) {
+            pending |= (uint16_t)(1u << bit);
+        }
+    }
+    for (int i = 0; i < e->map->chord_count; i++) {
+        int index = e->map->chords[i];
+        uint16_t buttons = e->map->list[index].buttons;
+        if ((pending & buttons) != buttons) {
+            continue;
+        }
+        for (unsigned members = buttons; members; members &= members - 1) {
+            int bit = __builtin_ctz(members);
+            timer_wheel_cancel(&e->wheel, &e->window[bit]);
+            e->phase[bit] = BUTTON_CHORD;
+            e->chord_of[bit] = (uint8_t)index;
+        }
+        action_start(e, index, e->now_ns);
+        return;
+    }
+}
+
+// A button the engine handles changed
+static inline void action_button(ActionEngine *e, int bit, bool pressed) {
+    uint16_t mask = (uint16_t)(1u << bit);
+    uint64_t now = e->now_ns;
+
+    if (pressed) {
+        if (e->phase[bit] == BUTTON_TAPPING) {
+            // Pressed again before the tap ended
+            timer_wheel_cancel(&e->wheel, &e->window[bit]);
+            action_single_end(e, bit, now);
+            e->phase[bit] = BUTTON_IDLE;
+        }
+        if (e->map->chord_mask & mask) {
+            e->phase[bit] = BUTTON_PENDING;
+            timer_wheel_schedule(&e->wheel, &e->window[bit], now + e->map->chord_window_ns);
+            action_check_chords(e);
+        } else {
+            e->phase[bit] = BUTTON_SINGLE;
+            action_single_start(e, bit, now);
+        }
+        return;
+    }
+
+    switch (e->phase[bit]) {
+        case BUTTON_PENDING:
+            // Released before its window ran out: act alone, as a tap
+            action_single_start(e, bit, now);
+            e->phase[bit] = BUTTON_TAPPING;
+            timer_wheel_schedule(&e->wheel, &e->window[bit], now + ACTION_TAP_NS);
+            break;
+        case BUTTON_SINGLE:
+            action_single_end(e, bit, now);
+            e->phase[bit] = BUTTON_IDLE;
+            break;
+        case BUTTON_CHORD:
+            // The first chord button released ends the chord
+            action_end(e, e->chord_of[bit], now);
+            e->phase[bit] = BUTTON_IDLE;
+            break;
+        default:
+            break;
+    }
+}
+
+// ============================================================================
+// Engine
+// ============================================================================
+
+static inline void action_engine_init(ActionEngine *e, const CompiledActions *map,
+                                      OutputSink *sink, bool *keys) {
+    memset(e, 0, sizeof(*e));
+    e->map = map;
+    e->sink = sink;
+    e->keys = keys;
+    timer_wheel_init(&e->wheel, TIMER_WHEEL_RESOLUTION, 0);
+    for (int i = 0; i < ACTION_BUTTONS; i++) {
+        timer_node_init(&e->window[i], action_window_fired, e, i);
+    }
+    for (int i = 0; i < ACTION_MAX; i++) {
+        timer_node_init(&e->runs[i].timer, action_timer_fired, e, i);
+    }
+}
+
+// Drop every timer and forget what is held. The keys themselves are
+// released by the owner (they are in its key state).
+static inline void action_engine_reset(ActionEngine *e) {
+    for (int i = 0; i < ACTION_BUTTONS; i++) {
+        timer_wheel_cancel(&e->wheel, &e->window[i]);
+        e->phase[i] = BUTTON_IDLE;
+    }
+    for (int i = 0; i < ACTION_MAX; i++) {
+        ActionRun *run = &e->runs[i];
+        timer_wheel_cancel(&e->wheel, &run->timer);
+        run->running = false;
+        run->held = false;
+        run->hold_fired = false;
+        run->tapping = false;
+        run->key_down = false;
+    }
+}
+
+// Move the engine's clock to now_ns, running every action due by then.
+// The clock never goes backwards.
+static inline void action_engine_advance(ActionEngine *e, uint64_t now_ns) {
+    if (now_ns < e->now_ns) {
+        return;
+    }
+    e->now_ns = now_ns;
+    timer_wheel_advance(&e->wheel, now_ns);
+}
+
+// When action_engine_advance next has something to do (UINT64_MAX: nothing)
+static inline uint64_t action_engine_next_ns(const ActionEngine *e) {
+    return timer_wheel_next_ns(&e->wheel);
+}
+
+#endif // ACTIONS_H
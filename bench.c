@@ -0,0 +1,635 @@
+// bench.c
+// Microbenchmarks for the translation kernels
+// Builds without libusb or any OS framework: events go to a null sink.
+// Every kernel runs over several input distributions, and each measurement
+// is repeated so the report shows the spread as well as the typical cost.
+// Results print as a table, or as JSON for comparing runs across commits.
+// Compile: make bench          (table)
+//          make bench-json     (writes bench.json)
+//
+// Usage: ./translation_bench [--json] [--capture FILE] [--repetitions N]
+//                            [--iterations N]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include "mapper.h"
+#include "capture.h"
+#include "sink_uinput.h"
+#include "timing.h"
+
+#define BENCH_INPUTS        4096        // Samples per distribution (power of two)
+#define BENCH_ITERATIONS    200000      // Operations per timed run
+#define BENCH_REPETITIONS   15          // Timed runs per kernel and distribution
+#define BENCH_MAX_REPETITIONS 101
+
+// One controller report, with the sticks in kernel lane order
+typedef struct {
+    int16_t sticks[STICK_LANES];        // left x, left y, right x, right y
+    uint16_t buttons;
+    uint8_t left_trigger;
+    uint8_t right_trigger;
+} BenchSample;
+
+typedef struct {
+    const char *name;
+    const char *description;
+    BenchSample samples[BENCH_INPUTS];
+    GipInputPacket packets[BENCH_INPUTS];   // The same samples as input reports
+} BenchDistribution;
+
+// A kernel runs `iterations` operations over the distribution's samples
+typedef void (*BenchKernel)(Mapper *m, const BenchDistribution *d, int iterations);
+
+typedef struct {
+    const char *name;
+    const char *description;
+    BenchKernel run;
+    Mapper *mapper;     // The mapper it runs on, reset before every run
+} BenchCase;
+
+typedef struct {
+    double mean;
+    double median;
+    double min;
+    double max;
+    double stddev;
+} BenchStats;
+
+// Prevents the compiler from discarding results
+static volatile float sink_value;
+
+// Deterministic xorshift so every run sees the same inputs
+static uint32_t bench_rng = 0x9E3779B9u;
+
+static uint32_t bench_rand(void) {
+    bench_rng ^= bench_rng << 13;
+    bench_rng ^= bench_rng >> 17;
+    bench_rng ^= bench_rng << 5;
+    return bench_rng;
+}
+
+// Uniform in [lo, hi]
+static int bench_range(int lo, int hi) {
+    return lo + (int)(bench_rand() % (uint32_t)(hi - lo + 1));
+}
+
+static int16_t clamp_axis(int value) {
+    return (int16_t)(value < -32768 ? -32768 : value > 32767 ? 32767 : value);
+}
+
+// ============================================================================
+// Input Distributions
+// ============================================================================
+
+// Controller on the desk: sticks resting inside the deadzone with sensor
+// noise, nothing pressed
+static void fill_idle(BenchDistribution *d) {
+    for (int i = 0; i < BENCH_INPUTS; i++) {
+        BenchSample *s = &d->samples[i];
+        for (int lane = 0; lane < STICK_LANES; lane++) {
+            s->sticks[lane] = (int16_t)bench_range(-1500, 1500);
+        }
+        s->buttons = 0;
+        s->left_trigger = (uint8_t)bench_range(0, 8);
+        s->right_trigger = (uint8_t)bench_range(0, 8);
+    }
+}
+
+// Someone playing: sticks glide toward targets that are mostly centered or
+// pushed to the rim, buttons are tapped and held now and then, triggers
+// are squeezed and let go gradually
+static void fill_realistic(BenchDistribution *d) {
+    int position[STICK_LANES] = {0};
+    int target[STICK_LANES] = {0};
+    int trigger[2] = {0};
+    int trigger_target[2] = {0};
+    uint16_t buttons = 0;
+    int hold = 0;
+
+    for (int i = 0; i < BENCH_INPUTS; i++) {
+        // A stick picks a new target every 64 samples or so
+        for (int stick = 0; stick < 2; stick++) {
+            if (bench_range(0, 63) == 0) {
+                int kind = bench_range(0, 9);
+                float angle = (float)bench_range(0, 6283) / 1000.0f;
+                float radius = kind < 3 ? 0.0f : kind < 7 ? 1.0f : (float)bench_range(30, 90) / 100.0f;
+                target[stick * 2] = (int)(cosf(angle) * radius * 32767.0f);
+                target[stick * 2 + 1] = (int)(sinf(angle) * radius * 32767.0f);
+            }
+        }
+        for (int lane = 0; lane < STICK_LANES; lane++) {
+            position[lane] += (target[lane] - position[lane]) / 8 + bench_range(-200, 200);
+            d->samples[i].sticks[lane] = clamp_axis(position[lane]);
+        }
+
+        // Tap or hold one button at a time
+        if (hold > 0) {
+            hold--;
+        } else if (buttons) {
+            buttons = 0;
+            hold = bench_range(10, 60);
+        } else {
+            buttons = (uint16_t)(1u << bench_range(2, 15));
+            hold = bench_range(3, 30);
+        }
+        d->samples[i].buttons = buttons;
+
+        for (int t = 0; t < 2; t++) {
+            if (bench_range(0, 127) == 0) {
+                trigger_target[t] = bench_range(0, 1) ? 255 : 0;
+            }
+            trigger[t] += (trigger_target[t] - trigger[t]) / 4;
+            if (trigger[t] != trigger_target[t] && abs(trigger_target[t] - trigger[t]) < 4) {
+                trigger[t] = trigger_target[t];
+            }
+        }
+        d->samples[i].left_trigger = (uint8_t)trigger[0];
+        d->samples[i].right_trigger = (uint8_t)trigger[1];
+    }
+}
+
+// Worst case for every branch: sticks uniformly random (including the
+// corners outside the unit circle), all buttons and both trigger
+// thresholds flipping at random on every sample
+static void fill_adversarial(BenchDistribution *d) {
+    for (int i = 0; i < BENCH_INPUTS; i++) {
+        BenchSample *s = &d->samples[i];
+        for (int lane = 0; lane < STICK_LANES; lane++) {
+            s->sticks[lane] = (int16_t)(bench_rand() & 0xFFFF);
+        }
+        s->buttons = (uint16_t)bench_rand();
+        s->left_trigger = (uint8_t)bench_rand();
+        s->right_trigger = (uint8_t)bench_rand();
+    }
+}
+
+// Input reports from a capture file, repeated to fill the buffer.
+// Returns false if the file has no input reports.
+static bool fill_capture(BenchDistribution *d, const char *path) {
+    CaptureReader reader;
+    if (capture_reader_open(&reader, path) < 0) {
+        fprintf(stderr, "❌ Could not open capture %s\n", path);
+        return false;
+    }
+
+    int n = 0;
+    for (size_t pass = 0; n < BENCH_INPUTS && pass < BENCH_INPUTS; pass++) {
+        int found = 0;
+        for (size_t r = 0; r < reader.count && n < BENCH_INPUTS; r++) {
+            uint64_t timestamp;
+            const uint8_t *data;
+            uint16_t length;
+            capture_reader_get(&reader, r, &timestamp, &data, &length);
+            if (length < sizeof(GipInputPacket) || data[0] != GIP_CMD_INPUT) {
+                continue;
+            }
+            GipInputPacket input;
+            memcpy(&input, data, sizeof(input));
+            BenchSample *s = &d->samples[n++];
+            s->sticks[0] = input.left_stick_x;
+            s->sticks[1] = input.left_stick_y;
+            s->sticks[2] = input.right_stick_x;
+            s->sticks[3] = input.right_stick_y;
+            s->buttons = input.buttons;
+            s->left_trigger = input.left_trigger;
+            s->right_trigger = input.right_trigger;
+            found++;
+        }
+        if (found == 0) {
+            break;
+        }
+    }
+    capture_reader_close(&reader);
+
+    if (n < BENCH_INPUTS) {
+        fprintf(stderr, "❌ No input reports in %s\n", path);
+        return false;
+    }
+    return true;
+}
+
+// Build the input reports mapper_process_input() takes
+static void fill_packets(BenchDistribution *d) {
+    for (int i = 0; i < BENCH_INPUTS; i++) {
+        const BenchSample *s = &d->samples[i];
+        GipInputPacket *p = &d->packets[i];
+        memset(p, 0, sizeof(*p));
+        p->header.command = GIP_CMD_INPUT;
+        p->header.length = sizeof(GipInputPacket) - sizeof(GipHeader);
+        p->buttons = s->buttons;
+        p->left_trigger = s->left_trigger;
+        p->right_trigger = s->right_trigger;
+        p->left_stick_x = s->sticks[0];
+        p->left_stick_y = s->sticks[1];
+        p->right_stick_x = s->sticks[2];
+        p->right_stick_y = s->sticks[3];
+    }
+}
+
+// ============================================================================
+// Kernels
+// ============================================================================
+
+#define SAMPLE(d, n) (&(d)->samples[(n) & (BENCH_INPUTS - 1)])
+
+// Deadzone: scalar apply_deadzone() per stick vs one kernel pass
+static void run_deadzone_scalar(Mapper *m, const BenchDistribution *d, int iterations) {
+    int32_t acc = 0;
+    for (int n = 0; n < iterations; n++) {
+        const int16_t *in = SAMPLE(d, n)->sticks;
+        int16_t lx = in[0], ly = in[1], rx = in[2], ry = in[3];
+        apply_deadzone(&lx, &ly, m->map->deadzone_sq);
+        apply_deadzone(&rx, &ry, m->map->deadzone_sq);
+        acc += lx + ly + rx + ry;
+    }
+    sink_value = (float)acc;
+}
+
+static void run_deadzone_kernel(Mapper *m, const BenchDistribution *d, int iterations) {
+    int32_t acc = 0;
+    for (int n = 0; n < iterations; n++) {
+        int16_t out[STICK_LANES];
+        stick_kernel_deadzone(SAMPLE(d, n)->sticks, out, (float)m->map->deadzone_sq);
+        acc += out[0] + out[1] + out[2] + out[3];
+    }
+    sink_value = (float)acc;
+}
+
+// Mouse tick: scalar process_stick_as_mouse() per stick vs one kernel pass
+static void run_mouse_scalar(Mapper *m, const BenchDistribution *d, int iterations) {
+    for (int n = 0; n < iterations; n++) {
+        const int16_t *in = SAMPLE(d, n)->sticks;
+        process_stick_as_mouse(m, in[0], in[1], &m->state.smoothed[0], &m->state.smoothed[1],
+                               0.7f, 0.4f);
+        process_stick_as_mouse(m, in[2], in[3], &m->state.smoothed[2], &m->state.smoothed[3],
+                               0.7f, 0.4f);
+    }
+    sink_value = m->state.mouse_dx + m->state.mouse_dy;
+}
+
+static void run_mouse_kernel(Mapper *m, const BenchDistribution *d, int iterations) {
+    for (int n = 0; n < iterations; n++) {
+        stick_kernel_mouse(SAMPLE(d, n)->sticks, m->state.smoothed, m->map->mouse_gain,
+                           &m->map->mouse_curve, 0.7f, 0.4f,
+                           &m->state.mouse_dx, &m->state.mouse_dy);
+    }
+    sink_value = m->state.mouse_dx + m->state.mouse_dy;
+}
+
+// The default bindings: left stick as keys, right stick as mouse
+static Mapper default_mapper;
+
+// Both sticks as keys (with their configured key bindings), key events included
+static void run_stick_keys(Mapper *m, const BenchDistribution *d, int iterations) {
+    const StickMapping *sticks = &m->config->sticks;
+    for (int n = 0; n < iterations; n++) {
+        const int16_t *in = SAMPLE(d, n)->sticks;
+        process_stick_as_keys(m, 0, in[0], in[1], sticks->left_up, sticks->left_down,
+                              sticks->left_left, sticks->left_right);
+        process_stick_as_keys(m, 1, in[2], in[3], sticks->right_up, sticks->right_down,
+                              sticks->right_left, sticks->right_right);
+    }
+}
+
+// The same with pwm_hz = 20, moving the mapper's clock 1 ms per sample so
+// the key edges fire as they would live
+static Mapper pwm_mapper;
+
+static void run_stick_pwm(Mapper *m, const BenchDistribution *d, int iterations) {
+    const StickMapping *sticks = &m->config->sticks;
+    for (int n = 0; n < iterations; n++) {
+        const int16_t *in = SAMPLE(d, n)->sticks;
+        mapper_advance(m, m->actions.now_ns + NS_PER_MS);
+        process_stick_as_pwm(m, 0, in[0], in[1], sticks->left_up, sticks->left_down,
+                             sticks->left_left, sticks->left_right);
+        process_stick_as_pwm(m, 2, in[2], in[3], sticks->right_up, sticks->right_down,
+                             sticks->right_left, sticks->right_right);
+    }
+}
+
+// 8 directions with key_release, overlap and snapback, on the same clock
+static Mapper sector_mapper;
+
+static void run_stick_sectors(Mapper *m, const BenchDistribution *d, int iterations) {
+    const StickMapping *sticks = &m->config->sticks;
+    for (int n = 0; n < iterations; n++) {
+        const int16_t *in = SAMPLE(d, n)->sticks;
+        mapper_advance(m, m->actions.now_ns + NS_PER_MS);
+        process_stick_as_keys(m, 0, in[0], in[1], sticks->left_up,
+                              sticks->left_down, sticks->left_left, sticks->left_right);
+        process_stick_as_keys(m, 1, in[2], in[3], sticks->right_up,
+                              sticks->right_down, sticks->right_left, sticks->right_right);
+    }
+}
+
+static void run_buttons(Mapper *m, const BenchDistribution *d, int iterations) {
+    for (int n = 0; n < iterations; n++) {
+        process_buttons(m, SAMPLE(d, n)->buttons);
+    }
+}
+
+static void run_triggers(Mapper *m, const BenchDistribution *d, int iterations) {
+    for (int n = 0; n < iterations; n++) {
+        const BenchSample *s = SAMPLE(d, n);
+        process_triggers(m, s->left_trigger, s->right_trigger);
+    }
+}
+
+// One whole input report, as the injector handles it
+static void run_process_input(Mapper *m, const BenchDistribution *d, int iterations) {
+    for (int n = 0; n < iterations; n++) {
+        mapper_process_input(m, &d->packets[n & (BENCH_INPUTS - 1)]);
+    }
+}
+
+// Whole reports with LB holding an "aim" layer on every other one, so each
+// report switches layers (a table swap plus releasing what changed)
+static Mapper layer_mapper;
+
+static void run_layer_switch(Mapper *m, const BenchDistribution *d, int iterations) {
+    for (int n = 0; n < iterations; n++) {
+        GipInputPacket input = d->packets[n & (BENCH_INPUTS - 1)];
+        input.buttons = (uint16_t)((input.buttons & ~XBOX_BTN_LB) | ((n & 1) ? XBOX_BTN_LB : 0));
+        mapper_process_input(m, &input);
+    }
+}
+
+// Gamepad passthrough: the report conversion instead of the translation
+static void run_gamepad_report(Mapper *m, const BenchDistribution *d, int iterations) {
+    GamepadReport report;
+    for (int n = 0; n < iterations; n++) {
+        gamepad_report_from_gip(&d->packets[n & (BENCH_INPUTS - 1)], &report);
+        sink_gamepad(m->sink, 0, &report);
+    }
+}
+
+// Advancing the action clock by one 1 ms tick with 512 timers pending
+// (each rescheduled up to 2 s out when it fires): the per-tick cost should
+// only depend on the timers that are due
+#define BENCH_TIMERS 512
+
+static TimerWheel bench_wheel;
+static TimerNode bench_timers[BENCH_TIMERS];
+static uint64_t bench_wheel_now;
+
+static void bench_timer_fired(TimerNode *node) {
+    uint64_t delay = (uint64_t)((node->arg * 7919) % 2000 + 1) * NS_PER_MS;
+    timer_wheel_schedule(&bench_wheel, node, node->deadline_ns + delay);
+}
+
+static void run_timer_wheel(Mapper *m, const BenchDistribution *d, int iterations) {
+    (void)m; (void)d;
+    if (bench_wheel.resolution_ns == 0) {
+        timer_wheel_init(&bench_wheel, TIMER_WHEEL_RESOLUTION, 0);
+        for (int i = 0; i < BENCH_TIMERS; i++) {
+            timer_node_init(&bench_timers[i], bench_timer_fired, NULL, i);
+            bench_timer_fired(&bench_timers[i]);
+        }
+    }
+    for (int n = 0; n < iterations; n++) {
+        bench_wheel_now += NS_PER_MS;
+        timer_wheel_advance(&bench_wheel, bench_wheel_now);
+    }
+}
+
+#ifdef __linux__
+// The same, with each frame's events written out by a uinput sink (one
+// write() per frame) to /dev/null: the cost of the syscall path without a
+// real device
+static Mapper uinput_mapper;
+
+static void run_uinput_frame(Mapper *m, const BenchDistribution *d, int iterations) {
+    for (int n = 0; n < iterations; n++) {
+        mapper_process_input(m, &d->packets[n & (BENCH_INPUTS - 1)]);
+    }
+}
+#endif
+
+static const BenchCase bench_cases[] = {
+    {"deadzone_scalar", "deadzone, scalar x2",             run_deadzone_scalar, &default_mapper},
+    {"deadzone_kernel", "deadzone, vector kernel",         run_deadzone_kernel, &default_mapper},
+    {"mouse_scalar",    "stick as mouse, scalar x2",       run_mouse_scalar,    &default_mapper},
+    {"mouse_kernel",    "stick as mouse, vector kernel",   run_mouse_kernel,    &default_mapper},
+    {"stick_keys",      "stick as keys x2",                run_stick_keys,      &default_mapper},
+    {"stick_pwm",       "stick as PWM keys x2",            run_stick_pwm,       &pwm_mapper},
+    {"stick_sectors",   "stick as 8-way keys x2",          run_stick_sectors,   &sector_mapper},
+    {"buttons",         "buttons",                         run_buttons,         &default_mapper},
+    {"triggers",        "triggers",                        run_triggers,        &default_mapper},
+    {"process_input",   "whole input report",              run_process_input,   &default_mapper},
+    {"layer_switch",    "report, switching layer each",    run_layer_switch,    &layer_mapper},
+    {"gamepad_report",  "gamepad passthrough report",      run_gamepad_report,  &default_mapper},
+    {"timer_wheel",     "action clock tick, 512 timers",   run_timer_wheel,     &default_mapper},
+#ifdef __linux__
+    {"uinput_frame",    "report via uinput to /dev/null",  run_uinput_frame,    &uinput_mapper},
+#endif
+};
+
+#define BENCH_CASE_COUNT ((int)(sizeof(bench_cases) / sizeof(bench_cases[0])))
+
+// ============================================================================
+// Measurement
+// ============================================================================
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Time `repetitions` runs of the kernel (after one untimed warm-up run)
+// from the same starting state, in ns per operation. The case's mapper is
+// reset to its base layer with no timers pending before each run; its clock
+// keeps counting up, which only shifts where the timer wheel starts.
+static BenchStats measure(const BenchCase *bench, const BenchDistribution *d,
+                          int iterations, int repetitions) {
+    double ns_per_op[BENCH_MAX_REPETITIONS];
+    Mapper *m = bench->mapper;
+
+    for (int r = -1; r < repetitions; r++) {
+        mapper_reset(m);
+        mapper_use_layers(m, 0);
+
+        uint64_t start = monotonic_ns();
+        bench->run(m, d, iterations);
+        uint64_t elapsed = monotonic_ns() - start;
+        if (r >= 0) {
+            ns_per_op[r] = (double)elapsed / iterations;
+        }
+    }
+
+    BenchStats stats = {0};
+    double sum = 0.0;
+    for (int r = 0; r < repetitions; r++) {
+        sum += ns_per_op[r];
+    }
+    stats.mean = sum / repetitions;
+    double variance = 0.0;
+    for (int r = 0; r < repetitions; r++) {
+        variance += (ns_per_op[r] - stats.mean) * (ns_per_op[r] - stats.mean);
+    }
+    stats.stddev = repetitions > 1 ? sqrt(variance / (repetitions - 1)) : 0.0;
+
+    qsort(ns_per_op, repetitions, sizeof(double), compare_double);
+    stats.min = ns_per_op[0];
+    stats.max = ns_per_op[repetitions - 1];
+    stats.median = repetitions % 2 ? ns_per_op[repetitions / 2]
+                                   : (ns_per_op[repetitions / 2 - 1] + ns_per_op[repetitions / 2]) / 2;
+    return stats;
+}
+
+// ============================================================================
+// Main
+// ============================================================================
+
+static void print_usage(const char *program) {
+    printf("Usage: %s [options]\n\n", program);
+    printf("Options:\n");
+    printf("  --json              Print results as JSON\n");
+    printf("  --capture FILE      Also run on the input reports in a capture file\n");
+    printf("  --repetitions N     Timed runs per measurement (default %d)\n", BENCH_REPETITIONS);
+    printf("  --iterations N      Operations per timed run (default %d)\n", BENCH_ITERATIONS);
+    printf("  --help              Show this help\n");
+}
+
+int main(int argc, char *argv[]) {
+    bool json = false;
+    const char *capture_path = NULL;
+    int repetitions = BENCH_REPETITIONS;
+    int iterations = BENCH_ITERATIONS;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) {
+            json = true;
+        } else if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc) {
+            capture_path = argv[++i];
+        } else if (strcmp(argv[i], "--repetitions") == 0 && i + 1 < argc) {
+            repetitions = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            iterations = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--help") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        } else {
+            fprintf(stderr, "❌ Unknown option: %s\n\n", argv[i]);
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (repetitions < 1 || repetitions > BENCH_MAX_REPETITIONS || iterations < 1) {
+        fprintf(stderr, "❌ Repetitions must be 1-%d and iterations positive\n",
+                BENCH_MAX_REPETITIONS);
+        return 1;
+    }
+
+    ControllerMapping config = get_default_mapping();
+    static CompiledProfile compiled;
+    compile_profile(&compiled, &config);
+
+    OutputSink null_sink = null_sink_make();
+    mapper_init(&default_mapper, &compiled, &null_sink);
+
+    // The same with analog (PWM) keys
+    ControllerMapping pwm_config = config;
+    pwm_config.sticks.pwm_hz = 20;
+    static CompiledProfile pwm_compiled;
+    compile_profile(&pwm_compiled, &pwm_config);
+    mapper_init(&pwm_mapper, &pwm_compiled, &null_sink);
+
+    // The same with 8 directions and every anti-chatter setting
+    ControllerMapping sector_config = config;
+    sector_config.sticks.key_directions = KEY_DIRECTIONS_8;
+    sector_config.sticks.key_release = 0.2f;
+    sector_config.sticks.sector_overlap = 10.0f;
+    sector_config.sticks.snapback_ms = 40;
+    static CompiledProfile sector_compiled;
+    compile_profile(&sector_compiled, &sector_config);
+    mapper_init(&sector_mapper, &sector_compiled, &null_sink);
+
+    // The same plus an aim layer on LB
+    LayerMapping *layer = &config.layers.list[config.layers.count++];
+    strcpy(layer->name, "aim");
+    layer->buttons = XBOX_BTN_LB;
+    LAYER_SET(layer, sticks.mouse_sensitivity, 0.6f);
+    LAYER_SET(layer, buttons.key_a, 0x24);
+    LAYER_SET(layer, buttons.key_b, 0x09);
+    static CompiledProfile layered;
+    compile_profile(&layered, &config);
+    mapper_init(&layer_mapper, &layered, &null_sink);
+#ifdef __linux__
+    static UinputSink uinput_sink;
+    static BatchSink uinput_batch;
+    int null_fd = open("/dev/null", O_WRONLY);
+    if (null_fd < 0) {
+        fprintf(stderr, "❌ Could not open /dev/null\n");
+        return 1;
+    }
+    uinput_sink_init(&uinput_sink, null_fd);
+    batch_sink_init(&uinput_batch, &uinput_sink.base);
+    mapper_init(&uinput_mapper, &compiled, &uinput_batch.base);
+#endif
+
+    static BenchDistribution distributions[4] = {
+        {.name = "idle",        .description = "sticks resting in the deadzone, nothing pressed"},
+        {.name = "realistic",   .description = "gliding sticks, occasional taps and trigger pulls"},
+        {.name = "adversarial", .description = "uniform random sticks, buttons and triggers"},
+        {.name = "capture"},
+    };
+    int distribution_count = 3;
+    fill_idle(&distributions[0]);
+    fill_realistic(&distributions[1]);
+    fill_adversarial(&distributions[2]);
+    if (capture_path) {
+        if (!fill_capture(&distributions[3], capture_path)) {
+            return 1;
+        }
+        distributions[3].description = capture_path;
+        distribution_count = 4;
+    }
+    for (int i = 0; i < distribution_count; i++) {
+        fill_packets(&distributions[i]);
+    }
+
+    if (json) {
+        printf("{\n");
+        printf("  \"isa\": \"%s\",\n", STICK_KERNEL_ISA);
+        printf("  \"iterations\": %d,\n", iterations);
+        printf("  \"repetitions\": %d,\n", repetitions);
+        printf("  \"unit\": \"ns/op\",\n");
+        printf("  \"results\": [");
+    } else {
+        printf("⏱️  Translation kernel benchmarks (stick kernel: %s, %d runs x %d operations)\n",
+               STICK_KERNEL_ISA, repetitions, iterations);
+    }
+
+    bool first = true;
+    for (int i = 0; i < distribution_count; i++) {
+        const BenchDistribution *d = &distributions[i];
+        if (!json) {
+            printf("\n  %s: %s\n", d->name, d->description);
+            printf("  %-30s %9s %9s %9s %9s %9s\n", "ns/op", "median", "mean", "min", "max", "stddev");
+        }
+        for (int k = 0; k < BENCH_CASE_COUNT; k++) {
+            const BenchCase *bench = &bench_cases[k];
+            BenchStats s = measure(bench, d, iterations, repetitions);
+            if (json) {
+                printf("%s\n    {\"kernel\": \"%s\", \"distribution\": \"%s\", "
+                       "\"median\": %.3f, \"mean\": %.3f, \"min\": %.3f, \"max\": %.3f, "
+                       "\"stddev\": %.3f}",
+                       first ? "" : ",", bench->name, d->name,
+                       s.median, s.mean, s.min, s.max, s.stddev);
+                first = false;
+            } else {
+                printf("  %-30s %9.2f %9.2f %9.2f %9.2f %9.2f\n", bench->description,
+                       s.median, s.mean, s.min, s.max, s.stddev);
+            }
+        }
+    }
+
+    if (json) {
+        printf("\n  ]\n}\n");
+    }
+    return 0;
+}
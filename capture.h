@@ -0,0 +1,276 @@
+// capture.h
+// GIP packet capture files: record raw controller packets, replay them later
+//
+// File layout (all integers little-endian):
+//   Header   "GIPCAP01" + uint32 version + uint32 reserved          (16 bytes)
+//   Records  uint64 timestamp_ns + uint16 length + length bytes     (repeated)
+//   Index    uint64 record offset, one per record
+//   Footer   uint64 index offset + uint64 record count + "GIPIDX01" (24 bytes)
+//
+// Timestamps are monotonic nanoseconds since the capture was opened. The
+// index lets readers memory-map the file and jump to any record directly;
+// a capture cut short before its index was written is still readable by
+// scanning the records.
+
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "timing.h"
+
+#define CAPTURE_MAGIC          "GIPCAP01"
+#define CAPTURE_INDEX_MAGIC    "GIPIDX01"
+#define CAPTURE_VERSION        1
+#define CAPTURE_HEADER_SIZE    16
+#define CAPTURE_RECORD_HEADER  10   // timestamp + length
+#define CAPTURE_FOOTER_SIZE    24
+
+// ============================================================================
+// Writer
+// ============================================================================
+
+typedef struct {
+    FILE *file;
+    uint64_t start_ns;       // Monotonic time the capture was opened
+    uint64_t position;       // Current file offset
+    uint64_t *offsets;       // Offset of every record, written as the index
+    size_t count;
+    size_t capacity;
+} CaptureWriter;
+
+// Returns 0 on success, -1 if the file couldn't be created
+static inline int capture_writer_open(CaptureWriter *w, const char *path) {
+    memset(w, 0, sizeof(*w));
+    w->file = fopen(path, "wb");
+    if (!w->file) {
+        return -1;
+    }
+
+    uint8_t header[CAPTURE_HEADER_SIZE] = {0};
+    uint32_t version = CAPTURE_VERSION;
+    memcpy(header, CAPTURE_MAGIC, 8);
+    memcpy(header + 8, &version, sizeof(version));
+    fwrite(header, 1, sizeof(header), w->file);
+
+    w->position = CAPTURE_HEADER_SIZE;
+    w->start_ns = monotonic_ns();
+    return 0;
+}
+
+// Append one packet. timestamp_ns is an absolute monotonic_ns() value.
+static inline int capture_writer_write(CaptureWriter *w, uint64_t timestamp_ns,
+                                       const uint8_t *data, uint16_t length) {
+    if (!w->file) {
+        return -1;
+    }
+
+    if (w->count == w->capacity) {
+        size_t capacity = w->capacity ? w->capacity * 2 : 4096;
+        uint64_t *offsets = realloc(w->offsets, capacity * sizeof(uint64_t));
+        if (!offsets) {
+            return -1;
+        }
+        w->offsets = offsets;
+        w->capacity = capacity;
+    }
+
+    uint8_t record[CAPTURE_RECORD_HEADER];
+    uint64_t relative = timestamp_ns >= w->start_ns ? timestamp_ns - w->start_ns : 0;
+    memcpy(record, &relative, 8);
+    memcpy(record + 8, &length, 2);
+    fwrite(record, 1, sizeof(record), w->file);
+    fwrite(data, 1, length, w->file);
+
+    w->offsets[w->count++] = w->position;
+    w->position += CAPTURE_RECORD_HEADER + length;
+    return 0;
+}
+
+// Write the index and footer, then close the file
+static inline void capture_writer_close(CaptureWriter *w) {
+    if (!w->file) {
+        return;
+    }
+
+    uint64_t index_offset = w->position;
+    uint64_t count = w->count;
+    fwrite(w->offsets, sizeof(uint64_t), w->count, w->file);
+
+    uint8_t footer[CAPTURE_FOOTER_SIZE];
+    memcpy(footer, &index_offset, 8);
+    memcpy(footer + 8, &count, 8);
+    memcpy(footer + 16, CAPTURE_INDEX_MAGIC, 8);
+    fwrite(footer, 1, sizeof(footer), w->file);
+
+    fclose(w->file);
+    free(w->offsets);
+    w->file = NULL;
+    w->offsets = NULL;
+}
+
+// ============================================================================
+// Reader (memory-mapped)
+// ============================================================================
+
+typedef struct {
+    const uint8_t *map;
+    size_t size;
+    const uint8_t *index;    // Points into the mapping, or at scanned_offsets
+    uint64_t *scanned_offsets;
+    size_t count;
+} CaptureReader;
+
+// Rebuild the record offsets by walking the file (capture without an index)
+static inline int capture_reader_scan(CaptureReader *r, size_t end) {
+    size_t capacity = 4096;
+    r->scanned_offsets = malloc(capacity * sizeof(uint64_t));
+    if (!r->scanned_offsets) {
+        return -1;
+    }
+
+    size_t offset = CAPTURE_HEADER_SIZE;
+    while (offset + CAPTURE_RECORD_HEADER <= end) {
+        uint16_t length;
+        memcpy(&length, r->map + offset + 8, 2);
+        if (offset + CAPTURE_RECORD_HEADER + length > end) {
+            break;  // Truncated final record
+        }
+        if (r->count == capacity) {
+            capacity *= 2;
+            uint64_t *offsets = realloc(r->scanned_offsets, capacity * sizeof(uint64_t));
+            if (!offsets) {
+                return -1;
+            }
+            r->scanned_offsets = offsets;
+        }
+        r->scanned_offsets[r->count++] = offset;
+        offset += CAPTURE_RECORD_HEADER + length;
+    }
+
+    r->index = (const uint8_t *)r->scanned_offsets;
+    return 0;
+}
+
+// The stored index fills exactly the space up to index_end, and every
+// record it points to lies between the header and the index. Sizes are
+// compared by division so a corrupt count can't overflow its way through.
+static inline bool capture_index_valid(const uint8_t *map, uint64_t index_offset,
+                                       uint64_t count, size_t index_end) {
+    if ((index_end - index_offset) % sizeof(uint64_t) != 0 ||
+        count != (index_end - index_offset) / sizeof(uint64_t) ||
+        count > (index_offset - CAPTURE_HEADER_SIZE) / sizeof(uint64_t)) {
+        return false;
+    }
+    for (uint64_t i = 0; i < count; i++) {
+        uint64_t offset;
+        uint16_t length;
+        memcpy(&offset, map + index_offset + i * sizeof(uint64_t), 8);
+        if (offset < CAPTURE_HEADER_SIZE || offset > index_offset ||
+            index_offset - offset < CAPTURE_RECORD_HEADER) {
+            return false;
+        }
+        memcpy(&length, map + offset + 8, 2);
+        if (index_offset - offset - CAPTURE_RECORD_HEADER < length) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Returns 0 on success, -1 if the file is missing or not a capture
+static inline int capture_reader_open(CaptureReader *r, const char *path) {
+    memset(r, 0, sizeof(*r));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < CAPTURE_HEADER_SIZE) {
+        close(fd);
+        return -1;
+    }
+
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+    r->map = map;
+    r->size = st.st_size;
+
+    if (memcmp(r->map, CAPTURE_MAGIC, 8) != 0) {
+        munmap((void *)r->map, r->size);
+        r->map = NULL;
+        return -1;
+    }
+
+    // Use the stored index when the footer is intact and the index checks
+    // out; otherwise walk the records in front of it
+    if (r->size >= CAPTURE_HEADER_SIZE + CAPTURE_FOOTER_SIZE) {
+        const uint8_t *footer = r->map + r->size - CAPTURE_FOOTER_SIZE;
+        uint64_t index_offset, count;
+        memcpy(&index_offset, footer, 8);
+        memcpy(&count, footer + 8, 8);
+        size_t index_end = r->size - CAPTURE_FOOTER_SIZE;
+
+        if (memcmp(footer + 16, CAPTURE_INDEX_MAGIC, 8) == 0 &&
+            index_offset >= CAPTURE_HEADER_SIZE && index_offset <= index_end) {
+            if (capture_index_valid(r->map, index_offset, count, index_end)) {
+                r->index = r->map + index_offset;
+                r->count = count;
+                return 0;
+            }
+            return capture_reader_scan(r, index_offset);
+        }
+    }
+
+    return capture_reader_scan(r, r->size);
+}
+
+// Fetch record i. data points into the mapping (no copy).
+static inline void capture_reader_get(const CaptureReader *r, size_t i, uint64_t *timestamp_ns,
+                                      const uint8_t **data, uint16_t *length) {
+    uint64_t offset;
+    memcpy(&offset, r->index + i * sizeof(uint64_t), 8);
+    memcpy(timestamp_ns, r->map + offset, 8);
+    memcpy(length, r->map + offset + 8, 2);
+    *data = r->map + offset + CAPTURE_RECORD_HEADER;
+}
+
+// Index of the first record at or after timestamp_ns (binary search)
+static inline size_t capture_reader_seek(const CaptureReader *r, uint64_t timestamp_ns) {
+    size_t lo = 0, hi = r->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        uint64_t t;
+        const uint8_t *data;
+        uint16_t length;
+        capture_reader_get(r, mid, &t, &data, &length);
+        if (t < timestamp_ns) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static inline void capture_reader_close(CaptureReader *r) {
+    if (r->map) {
+        munmap((void *)r->map, r->size);
+    }
+    free(r->scanned_offsets);
+    memset(r, 0, sizeof(*r));
+}
+
+#endif // CAPTURE_H
@@ -0,0 +1,610 @@
+// config_file.h
+// Runtime configuration file
+// The settings from keymapping.h in a plain text format, so bindings and
+// tuning can change without a rebuild. Anything the file doesn't mention
+// keeps its value from get_default_mapping().
+//
+//   # Comments start with # or ;
+//   [buttons]
+//   a = 0x31                  # Keycodes from the reference in keymapping.h
+//
+//   [sticks]
+//   left_mode = wasd          # wasd, arrows, mouse, disabled
+//   mouse_sensitivity = 2.0
+//   curve_type = piecewise    # power, piecewise, bezier
+//   curve_points = 0.6:0.2, 0.9:0.6
+//
+//   [action]                  # Repeat for each action (up to 16)
+//   buttons = lb+a            # One button, or a chord
+//   type = macro              # key, tap_hold, turbo, macro
+//   steps = 0x04:30, wait:50, 0x22:30
+//
+//   [layer]                   # Repeat for each layer (up to 4)
+//   buttons = lb              # Held to activate
+//   sticks.mouse_sensitivity = 0.6    # Any [buttons]/[sticks]/[triggers]
+//   buttons.a = 0x24                  # setting, as section.key
+//
+//   [profile]
+//   apps = Safari, Counter-Strike 2   # Frontmost apps that select this file
+//
+// See controller.conf.example for every key.
+
+#ifndef CONFIG_FILE_H
+#define CONFIG_FILE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <strings.h>
+#include <stdarg.h>
+#include <ctype.h>
+#include "keymapping.h"
+#include "console.h"
+
+typedef enum {
+    CONFIG_KEYCODE,       // uint16_t, 0x00-0xFF
+    CONFIG_STICK_MODE,    // StickMode
+    CONFIG_TRIGGER_MODE,  // TriggerMode
+    CONFIG_CURVE_TYPE,    // MouseCurveType
+    CONFIG_KEY_DIRECTIONS, // KeyDirections
+    CONFIG_FLOAT,         // float in [min, max]
+    CONFIG_INT16,         // int16_t in [min, max]
+    CONFIG_UINT8,         // uint8_t in [min, max]
+    CONFIG_UINT16,        // uint16_t in [min, max]
+    CONFIG_BOOL,          // true/false, yes/no, on/off, 1/0
+    CONFIG_CURVE_POINTS,  // "x:y, x:y, ..." into mouse_curve_points
+    CONFIG_BUTTONS,       // uint16_t XBOX_BTN_* mask, "lb+a"
+    CONFIG_ACTION_TYPE,   // ActionType
+    CONFIG_MACRO_STEPS,   // "key:ms, wait:ms, ..." into an ActionMapping
+    CONFIG_NAME,          // char[LAYER_NAME_MAX]
+    CONFIG_APPS           // "App, App, ..." into a ProfileMapping
+} ConfigValueType;
+
+// Fields of the repeatable [action] and [layer] sections point into
+// list[0]; each header moves on to the next entry
+typedef struct {
+    const char *section;
+    const char *key;
+    ConfigValueType type;
+    size_t offset;        // Into ControllerMapping
+    float min, max;
+} ConfigField;
+
+#define CONFIG_FIELD(section, key, type, member, min, max) \
+    {section, key, type, offsetof(ControllerMapping, member), min, max}
+
+static const ConfigField config_fields[] = {
+    CONFIG_FIELD("buttons", "a",          CONFIG_KEYCODE, buttons.key_a, 0, 0),
+    CONFIG_FIELD("buttons", "b",          CONFIG_KEYCODE, buttons.key_b, 0, 0),
+    CONFIG_FIELD("buttons", "x",          CONFIG_KEYCODE, buttons.key_x, 0, 0),
+    CONFIG_FIELD("buttons", "y",          CONFIG_KEYCODE, buttons.key_y, 0, 0),
+    CONFIG_FIELD("buttons", "lb",         CONFIG_KEYCODE, buttons.key_lb, 0, 0),
+    CONFIG_FIELD("buttons", "rb",         CONFIG_KEYCODE, buttons.key_rb, 0, 0),
+    CONFIG_FIELD("buttons", "ls",         CONFIG_KEYCODE, buttons.key_ls, 0, 0),
+    CONFIG_FIELD("buttons", "rs",         CONFIG_KEYCODE, buttons.key_rs, 0, 0),
+    CONFIG_FIELD("buttons", "view",       CONFIG_KEYCODE, buttons.key_view, 0, 0),
+    CONFIG_FIELD("buttons", "menu",       CONFIG_KEYCODE, buttons.key_menu, 0, 0),
+    CONFIG_FIELD("buttons", "dpad_up",    CONFIG_KEYCODE, buttons.key_dpad_up, 0, 0),
+    CONFIG_FIELD("buttons", "dpad_down",  CONFIG_KEYCODE, buttons.key_dpad_down, 0, 0),
+    CONFIG_FIELD("buttons", "dpad_left",  CONFIG_KEYCODE, buttons.key_dpad_left, 0, 0),
+    CONFIG_FIELD("buttons", "dpad_right", CONFIG_KEYCODE, buttons.key_dpad_right, 0, 0),
+
+    CONFIG_FIELD("sticks", "left_mode",   CONFIG_STICK_MODE, sticks.left_stick_mode, 0, 0),
+    CONFIG_FIELD("sticks", "left_up",     CONFIG_KEYCODE, sticks.left_up, 0, 0),
+    CONFIG_FIELD("sticks", "left_down",   CONFIG_KEYCODE, sticks.left_down, 0, 0),
+    CONFIG_FIELD("sticks", "left_left",   CONFIG_KEYCODE, sticks.left_left, 0, 0),
+    CONFIG_FIELD("sticks", "left_right",  CONFIG_KEYCODE, sticks.left_right, 0, 0),
+    CONFIG_FIELD("sticks", "right_mode",  CONFIG_STICK_MODE, sticks.right_stick_mode, 0, 0),
+    CONFIG_FIELD("sticks", "right_up",    CONFIG_KEYCODE, sticks.right_up, 0, 0),
+    CONFIG_FIELD("sticks", "right_down",  CONFIG_KEYCODE, sticks.right_down, 0, 0),
+    CONFIG_FIELD("sticks", "right_left",  CONFIG_KEYCODE, sticks.right_left, 0, 0),
+    CONFIG_FIELD("sticks", "right_right", CONFIG_KEYCODE, sticks.right_right, 0, 0),
+    CONFIG_FIELD("sticks", "mouse_sensitivity", CONFIG_FLOAT, sticks.mouse_sensitivity, 0.0f, 20.0f),
+    CONFIG_FIELD("sticks", "mouse_curve",       CONFIG_FLOAT, sticks.mouse_curve, 0.1f, 10.0f),
+    CONFIG_FIELD("sticks", "mouse_smoothing",   CONFIG_FLOAT, sticks.mouse_smoothing, 0.0f, 0.99f),
+    CONFIG_FIELD("sticks", "deadzone",          CONFIG_INT16, sticks.deadzone, 0, 32767),
+    CONFIG_FIELD("sticks", "curve_type",        CONFIG_CURVE_TYPE, sticks.mouse_curve_type, 0, 0),
+    CONFIG_FIELD("sticks", "curve_points",      CONFIG_CURVE_POINTS, sticks, 0, 0),
+    CONFIG_FIELD("sticks", "pwm_hz",            CONFIG_UINT16, sticks.pwm_hz, 0, 200),
+    CONFIG_FIELD("sticks", "walk_key",          CONFIG_KEYCODE, sticks.walk_key, 0, 0),
+    CONFIG_FIELD("sticks", "walk_below",        CONFIG_FLOAT, sticks.walk_below, 0.0f, 1.0f),
+    CONFIG_FIELD("sticks", "run_key",           CONFIG_KEYCODE, sticks.run_key, 0, 0),
+    CONFIG_FIELD("sticks", "run_above",         CONFIG_FLOAT, sticks.run_above, 0.0f, 1.0f),
+    CONFIG_FIELD("sticks", "key_directions",    CONFIG_KEY_DIRECTIONS, sticks.key_directions, 0, 0),
+    CONFIG_FIELD("sticks", "key_press",         CONFIG_FLOAT, sticks.key_press, 0.05f, 1.0f),
+    CONFIG_FIELD("sticks", "key_release",       CONFIG_FLOAT, sticks.key_release, 0.0f, 1.0f),
+    CONFIG_FIELD("sticks", "sector_overlap",    CONFIG_FLOAT, sticks.sector_overlap, 0.0f, 45.0f),
+    CONFIG_FIELD("sticks", "snapback_ms",       CONFIG_UINT16, sticks.snapback_ms, 0, 500),
+
+    CONFIG_FIELD("triggers", "left_mode",  CONFIG_TRIGGER_MODE, triggers.left_trigger_mode, 0, 0),
+    CONFIG_FIELD("triggers", "right_mode", CONFIG_TRIGGER_MODE, triggers.right_trigger_mode, 0, 0),
+    CONFIG_FIELD("triggers", "left_key",   CONFIG_KEYCODE, triggers.left_trigger_key, 0, 0),
+    CONFIG_FIELD("triggers", "right_key",  CONFIG_KEYCODE, triggers.right_trigger_key, 0, 0),
+    CONFIG_FIELD("triggers", "threshold",  CONFIG_UINT8, triggers.threshold, 0, 255),
+
+    CONFIG_FIELD("actions", "chord_window_ms", CONFIG_UINT16, actions.chord_window_ms, 0, 1000),
+
+    CONFIG_FIELD("action", "buttons",  CONFIG_BUTTONS, actions.list[0].buttons, 0, 0),
+    CONFIG_FIELD("action", "type",     CONFIG_ACTION_TYPE, actions.list[0].type, 0, 0),
+    CONFIG_FIELD("action", "key",      CONFIG_KEYCODE, actions.list[0].key, 0, 0),
+    CONFIG_FIELD("action", "hold_key", CONFIG_KEYCODE, actions.list[0].hold_key, 0, 0),
+    CONFIG_FIELD("action", "hold_ms",  CONFIG_UINT16, actions.list[0].hold_ms, 1, 10000),
+    CONFIG_FIELD("action", "rate_hz",  CONFIG_UINT16, actions.list[0].rate_hz, 1, 100),
+    CONFIG_FIELD("action", "steps",    CONFIG_MACRO_STEPS, actions.list[0], 0, 0),
+
+    // Plus any [buttons], [sticks] or [triggers] setting as section.key
+    CONFIG_FIELD("layer", "name",    CONFIG_NAME, layers.list[0].name, 0, 0),
+    CONFIG_FIELD("layer", "buttons", CONFIG_BUTTONS, layers.list[0].buttons, 0, 0),
+
+    CONFIG_FIELD("profile", "apps", CONFIG_APPS, profile, 0, 0),
+
+    CONFIG_FIELD("advanced", "console_output", CONFIG_BOOL, console_output_enabled, 0, 0),
+    CONFIG_FIELD("advanced", "streaming_mode", CONFIG_BOOL, streaming_mode, 0, 0),
+    CONFIG_FIELD("advanced", "usb_transfers",  CONFIG_UINT8, usb_transfers, 1, 16),
+    CONFIG_FIELD("advanced", "output_rate_hz", CONFIG_UINT16, output_rate_hz, 10, 8000),
+};
+
+#undef CONFIG_FIELD
+
+// Match value against names[]; returns the index or -1
+static inline int config_parse_name(const char *value, const char *const *names, int count) {
+    for (int i = 0; i < count; i++) {
+        if (strcasecmp(value, names[i]) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static inline bool config_parse_number(const char *value, float min, float max, long *out) {
+    char *end;
+    long n = strtol(value, &end, 0);
+    if (end == value || *end != '\0' || n < (long)min || n > (long)max) {
+        return false;
+    }
+    *out = n;
+    return true;
+}
+
+// "x:y, x:y, ..." with 0 <= x, y <= 1 and x increasing
+static inline bool config_parse_curve_points(const char *value, StickMapping *sticks) {
+    float points[MOUSE_CURVE_MAX_POINTS][2];
+    int count = 0;
+    const char *p = value;
+
+    while (*p) {
+        char *end;
+        float x = strtof(p, &end);
+        if (end == p || *end != ':') return false;
+        p = end + 1;
+        float y = strtof(p, &end);
+        if (end == p) return false;
+        p = end;
+        while (isspace((unsigned char)*p)) p++;
+        if (*p == ',') p++;
+        while (isspace((unsigned char)*p)) p++;
+
+        if (count == MOUSE_CURVE_MAX_POINTS || x < 0.0f || x > 1.0f || y < 0.0f || y > 1.0f ||
+            (count > 0 && x < points[count - 1][0])) {
+            return false;
+        }
+        points[count][0] = x;
+        points[count][1] = y;
+        count++;
+    }
+
+    memcpy(sticks->mouse_curve_points, points, sizeof(points[0]) * count);
+    sticks->mouse_curve_point_count = (uint8_t)count;
+    return true;
+}
+
+// "lb+a": button names as in [buttons], joined with +
+static inline bool config_parse_buttons(const char *value, uint16_t *buttons) {
+    static const struct {
+        const char *name;
+        uint16_t mask;
+    } names[] = {
+        {"a", XBOX_BTN_A}, {"b", XBOX_BTN_B}, {"x", XBOX_BTN_X}, {"y", XBOX_BTN_Y},
+        {"lb", XBOX_BTN_LB}, {"rb", XBOX_BTN_RB}, {"ls", XBOX_BTN_LS}, {"rs", XBOX_BTN_RS},
+        {"view", XBOX_BTN_VIEW}, {"menu", XBOX_BTN_MENU},
+        {"dpad_up", XBOX_BTN_DPAD_UP}, {"dpad_down", XBOX_BTN_DPAD_DOWN},
+        {"dpad_left", XBOX_BTN_DPAD_LEFT}, {"dpad_right", XBOX_BTN_DPAD_RIGHT},
+    };
+    uint16_t mask = 0;
+    const char *p = value;
+
+    while (*p) {
+        while (isspace((unsigned char)*p)) p++;
+        size_t length = strcspn(p, "+");
+        size_t end = length;
+        while (end > 0 && isspace((unsigned char)p[end - 1])) end--;
+        size_t i;
+        for (i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+            if (strlen(names[i].name) == end && strncasecmp(p, names[i].name, end) == 0) {
+                break;
+            }
+        }
+        if (i == sizeof(names) / sizeof(names[0])) return false;
+        mask |= names[i].mask;
+        p += length;
+        if (*p == '+') p++;
+    }
+    if (mask == 0) return false;
+    *buttons = mask;
+    return true;
+}
+
+// "key:ms, wait:ms, ..." with keycodes 0-255 and 1-10000 ms per step
+static inline bool config_parse_macro_steps(const char *value, ActionMapping *action) {
+    MacroStep steps[ACTION_MACRO_MAX];
+    int count = 0;
+    const char *p = value;
+
+    while (*p) {
+        char *end;
+        long key;
+        if (strncasecmp(p, "wait", 4) == 0) {
+            key = ACTION_NO_KEY;
+            end = (char *)p + 4;
+        } else {
+            key = strtol(p, &end, 0);
+            if (end == p || key < 0 || key > 255) return false;
+        }
+        if (*end != ':') return false;
+        p = end + 1;
+        long ms = strtol(p, &end, 0);
+        if (end == p || ms < 1 || ms > 10000) return false;
+        p = end;
+        while (isspace((unsigned char)*p)) p++;
+        if (*p == ',') p++;
+        while (isspace((unsigned char)*p)) p++;
+
+        if (count == ACTION_MACRO_MAX) return false;
+        steps[count].key = (uint16_t)key;
+        steps[count].hold_ms = (uint16_t)ms;
+        count++;
+    }
+
+    memcpy(action->steps, steps, sizeof(steps[0]) * count);
+    action->step_count = (uint8_t)count;
+    return true;
+}
+
+// "App, App, ...": application names as the OS shows them
+static inline bool config_parse_apps(const char *value, ProfileMapping *profile) {
+    ProfileMapping parsed = {0};
+    const char *p = value;
+
+    while (*p) {
+        while (isspace((unsigned char)*p)) p++;
+        size_t length = strcspn(p, ",");
+        size_t end = length;
+        while (end > 0 && isspace((unsigned char)p[end - 1])) end--;
+        if (end == 0 || end >= PROFILE_APP_NAME_MAX || parsed.app_count == PROFILE_APPS_MAX) {
+            return false;
+        }
+        memcpy(parsed.apps[parsed.app_count], p, end);
+        parsed.apps[parsed.app_count][end] = '\0';
+        parsed.app_count++;
+        p += length;
+        if (*p == ',') p++;
+    }
+    *profile = parsed;
+    return true;
+}
+
+// Bytes a layer override of field takes; 0 if layers can't change it
+static inline size_t config_field_size(const ConfigField *field) {
+    if (strcmp(field->section, "buttons") != 0 && strcmp(field->section, "sticks") != 0 &&
+        strcmp(field->section, "triggers") != 0) {
+        return 0;
+    }
+    switch (field->type) {
+        case CONFIG_KEYCODE:
+        case CONFIG_INT16:
+        case CONFIG_UINT16:     return sizeof(uint16_t);
+        case CONFIG_STICK_MODE: return sizeof(StickMode);
+        case CONFIG_TRIGGER_MODE: return sizeof(TriggerMode);
+        case CONFIG_CURVE_TYPE: return sizeof(MouseCurveType);
+        case CONFIG_KEY_DIRECTIONS: return sizeof(KeyDirections);
+        case CONFIG_FLOAT:      return sizeof(float);
+        case CONFIG_UINT8:
+        case CONFIG_BOOL:       return sizeof(uint8_t);
+        default:                return 0;
+    }
+}
+
+// shift is added to the field's offset (the current [action] or [layer] entry)
+static inline bool config_apply_field(ControllerMapping *mapping, const ConfigField *field,
+                                      size_t shift, const char *value) {
+    static const char *const stick_modes[] = {"wasd", "arrows", "mouse", "disabled"};
+    static const char *const trigger_modes[] = {"mouse", "key", "disabled"};
+    static const char *const curve_types[] = {"power", "piecewise", "bezier"};
+    static const char *const key_directions[] = {"axes", "4", "8"};
+    static const char *const action_types[] = {"key", "tap_hold", "turbo", "macro"};
+    static const char *const bool_true[] = {"true", "yes", "on", "1"};
+    static const char *const bool_false[] = {"false", "no", "off", "0"};
+
+    void *target = (char *)mapping + field->offset + shift;
+    long n;
+    int index;
+    char *end;
+
+    switch (field->type) {
+        case CONFIG_KEYCODE:
+            // Keycodes index the 256-entry key state table
+            if (!config_parse_number(value, 0, 255, &n)) return false;
+            *(uint16_t *)target = (uint16_t)n;
+            return true;
+        case CONFIG_STICK_MODE:
+            if ((index = config_parse_name(value, stick_modes, 4)) < 0) return false;
+            *(StickMode *)target = (StickMode)index;
+            return true;
+        case CONFIG_TRIGGER_MODE:
+            if ((index = config_parse_name(value, trigger_modes, 3)) < 0) return false;
+            *(TriggerMode *)target = (TriggerMode)index;
+            return true;
+        case CONFIG_CURVE_TYPE:
+            if ((index = config_parse_name(value, curve_types, 3)) < 0) return false;
+            *(MouseCurveType *)target = (MouseCurveType)index;
+            return true;
+        case CONFIG_KEY_DIRECTIONS:
+            if ((index = config_parse_name(value, key_directions, 3)) < 0) return false;
+            *(KeyDirections *)target = (KeyDirections)index;
+            return true;
+        case CONFIG_FLOAT: {
+            float f = strtof(value, &end);
+            if (end == value || *end != '\0' || !(f >= field->min && f <= field->max)) return false;
+            *(float *)target = f;
+            return true;
+        }
+        case CONFIG_INT16:
+            if (!config_parse_number(value, field->min, field->max, &n)) return false;
+            *(int16_t *)target = (int16_t)n;
+            return true;
+        case CONFIG_UINT8:
+            if (!config_parse_number(value, field->min, field->max, &n)) return false;
+            *(uint8_t *)target = (uint8_t)n;
+            return true;
+        case CONFIG_UINT16:
+            if (!config_parse_number(value, field->min, field->max, &n)) return false;
+            *(uint16_t *)target = (uint16_t)n;
+            return true;
+        case CONFIG_BOOL:
+            if (config_parse_name(value, bool_true, 4) >= 0) {
+                *(bool *)target = true;
+            } else if (config_parse_name(value, bool_false, 4) >= 0) {
+                *(bool *)target = false;
+            } else {
+                return false;
+            }
+            return true;
+        case CONFIG_CURVE_POINTS:
+            return config_parse_curve_points(value, (StickMapping *)target);
+        case CONFIG_BUTTONS:
+            return config_parse_buttons(value, (uint16_t *)target);
+        case CONFIG_ACTION_TYPE:
+            if ((index = config_parse_name(value, action_types, 4)) < 0) return false;
+            *(ActionType *)target = (ActionType)index;
+            return true;
+        case CONFIG_MACRO_STEPS:
+            return config_parse_macro_steps(value, (ActionMapping *)target);
+        case CONFIG_NAME:
+            if (*value == '\0' || strlen(value) >= LAYER_NAME_MAX) return false;
+            strcpy((char *)target, value);
+            return true;
+        case CONFIG_APPS:
+            return config_parse_apps(value, (ProfileMapping *)target);
+    }
+    return false;
+}
+
+static inline const ConfigField *config_find_field(const char *section, const char *key) {
+    for (size_t i = 0; i < sizeof(config_fields) / sizeof(config_fields[0]); i++) {
+        if (strcasecmp(section, config_fields[i].section) == 0 &&
+            strcasecmp(key, config_fields[i].key) == 0) {
+            return &config_fields[i];
+        }
+    }
+    return NULL;
+}
+
+// "section.key = value" in a [layer]: parse it as the plain setting would
+// be, then keep only the resulting bytes as an override. Returns false
+// with *error set if it can't be used.
+static inline bool config_apply_layer_override(ControllerMapping *mapping, LayerMapping *layer,
+                                               const char *key, const char *value,
+                                               const char **error) {
+    char section[32];
+    const char *dot = strchr(key, '.');
+    const ConfigField *field = NULL;
+    if (dot && (size_t)(dot - key) < sizeof(section)) {
+        memcpy(section, key, dot - key);
+        section[dot - key] = '\0';
+        field = config_find_field(section, dot + 1);
+    }
+    size_t size = field ? config_field_size(field) : 0;
+    if (size == 0) {
+        *error = "layers can't change";
+        return false;
+    }
+
+    ControllerMapping scratch = *mapping;
+    if (!config_apply_field(&scratch, field, 0, value)) {
+        *error = "invalid value for";
+        return false;
+    }
+
+    LayerOverride *override = layer_override_slot(layer, field->offset);
+    if (!override) {
+        *error = "too many settings in this layer at";
+        return false;
+    }
+    override->offset = (uint16_t)field->offset;
+    override->size = (uint8_t)size;
+    memcpy(override->value, (const uint8_t *)&scratch + field->offset, size);
+    return true;
+}
+
+static inline char *config_trim(char *s) {
+    while (isspace((unsigned char)*s)) s++;
+    char *end = s + strlen(s);
+    while (end > s && isspace((unsigned char)end[-1])) end--;
+    *end = '\0';
+    return s;
+}
+
+// Diagnostics go to log when there is one (hot reloads, while the
+// renderer owns the terminal) and to stderr otherwise (startup)
+__attribute__((format(printf, 2, 3)))
+static inline void config_report(ConsoleLog *log, const char *format, ...) {
+    char text[CONSOLE_LINE_MAX];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    if (log) {
+        console_log(log, "%s", text);
+    } else {
+        fputs(text, stderr);
+    }
+}
+
+// Load path on top of *mapping. Every problem is reported with its line
+// number (see config_report); if there were any, *mapping is left
+// untouched and false is returned, so a half-edited file never takes effect.
+static inline bool config_file_load(const char *path, ControllerMapping *mapping,
+                                    ConsoleLog *log) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        config_report(log, "❌ Cannot open config %s\n", path);
+        return false;
+    }
+
+    ControllerMapping loaded = *mapping;
+    char line[512];
+    char section[32] = "";
+    int line_number = 0;
+    int errors = 0;
+    bool actions_seen = false;
+    bool layers_seen = false;
+
+    while (fgets(line, sizeof(line), f)) {
+        line_number++;
+        line[strcspn(line, "#;\r\n")] = '\0';
+        char *text = config_trim(line);
+        if (*text == '\0') {
+            continue;
+        }
+
+        if (*text == '[') {
+            char *close = strchr(text, ']');
+            if (!close || close[1] != '\0' || close - text - 1 >= (long)sizeof(section)) {
+                config_report(log, "⚠️  %s:%d: bad section header\n", path, line_number);
+                errors++;
+                continue;
+            }
+            *close = '\0';
+            strcpy(section, config_trim(text + 1));
+
+            // A file's actions replace the inherited ones
+            if (strcasecmp(section, "action") == 0) {
+                if (!actions_seen) {
+                    loaded.actions.count = 0;
+                    actions_seen = true;
+                }
+                if (loaded.actions.count == ACTION_MAX) {
+                    config_report(log, "⚠️  %s:%d: more than %d actions\n", path, line_number,
+                                  ACTION_MAX);
+                    errors++;
+                    continue;
+                }
+                ActionMapping *action = &loaded.actions.list[loaded.actions.count++];
+                memset(action, 0, sizeof(*action));
+                action->hold_ms = 200;
+                action->rate_hz = 10;
+            }
+
+            // Likewise for layers
+            if (strcasecmp(section, "layer") == 0) {
+                if (!layers_seen) {
+                    loaded.layers.count = 0;
+                    layers_seen = true;
+                }
+                if (loaded.layers.count == LAYER_MAX) {
+                    config_report(log, "⚠️  %s:%d: more than %d layers\n", path, line_number,
+                                  LAYER_MAX);
+                    errors++;
+                    continue;
+                }
+                LayerMapping *layer = &loaded.layers.list[loaded.layers.count++];
+                memset(layer, 0, sizeof(*layer));
+                snprintf(layer->name, sizeof(layer->name), "layer %d", loaded.layers.count);
+            }
+            continue;
+        }
+
+        char *equals = strchr(text, '=');
+        if (!equals) {
+            config_report(log, "⚠️  %s:%d: expected key = value\n", path, line_number);
+            errors++;
+            continue;
+        }
+        *equals = '\0';
+        char *key = config_trim(text);
+        char *value = config_trim(equals + 1);
+
+        const ConfigField *field = config_find_field(section, key);
+        size_t shift = 0;
+        if (field && strcmp(field->section, "action") == 0) {
+            shift = (loaded.actions.count - 1) * sizeof(ActionMapping);
+        } else if (field && strcmp(field->section, "layer") == 0) {
+            shift = (loaded.layers.count - 1) * sizeof(LayerMapping);
+        }
+        const char *error;
+        if (!field && strcasecmp(section, "layer") == 0 && loaded.layers.count > 0) {
+            if (!config_apply_layer_override(&loaded, &loaded.layers.list[loaded.layers.count - 1],
+                                             key, value, &error)) {
+                config_report(log, "⚠️  %s:%d: %s %s = %s\n", path, line_number, error, key,
+                              value);
+                errors++;
+            }
+        } else if (!field) {
+            config_report(log, "⚠️  %s:%d: unknown setting [%s] %s\n", path, line_number,
+                          section, key);
+            errors++;
+        } else if (!config_apply_field(&loaded, field, shift, value)) {
+            config_report(log, "⚠️  %s:%d: invalid value for %s: %s\n", path, line_number,
+                          key, value);
+            errors++;
+        }
+    }
+    fclose(f);
+
+    for (int i = 0; i < loaded.actions.count; i++) {
+        if (loaded.actions.list[i].buttons == 0) {
+            config_report(log, "⚠️  %s: action %d has no buttons\n", path, i + 1);
+            errors++;
+        }
+    }
+    for (int i = 0; i < loaded.layers.count; i++) {
+        if (loaded.layers.list[i].buttons == 0) {
+            config_report(log, "⚠️  %s: layer \"%s\" has no buttons\n", path,
+                          loaded.layers.list[i].name);
+            errors++;
+        }
+    }
+
+    if (errors > 0) {
+        config_report(log, "❌ %s: %d error%s, keeping previous settings\n",
+                      path, errors, errors == 1 ? "" : "s");
+        return false;
+    }
+    *mapping = loaded;
+    return true;
+}
+
+#endif // CONFIG_FILE_H
@@ -0,0 +1,153 @@
+// config_watch.h
+// Hot reload for the runtime configuration file
+// A background thread polls the file. When it changes, the thread parses
+// and compiles the new mapping and publishes it with an atomic pointer
+// swap. The input loop picks up the pointer between packets, so it never
+// blocks and never sees a partially updated mapping.
+//
+// Reclamation: the input loop reports the newest generation it has seen
+// each time it passes a quiescent point (holding no mapping pointer). The
+// watcher frees a replaced mapping only after that report catches up.
+
+#ifndef CONFIG_WATCH_H
+#define CONFIG_WATCH_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include "config_file.h"
+#include "console.h"
+#include "mapper.h"
+#include "timing.h"
+
+#define CONFIG_WATCH_POLL_NS    (500 * NS_PER_MS)
+
+typedef struct {
+    const char *path;
+    ControllerMapping defaults;     // Base that every reload starts from
+    ConsoleLog *log;                // Reload messages and file errors
+
+    _Atomic(CompiledProfile *) current;
+    atomic_uint_fast64_t generation;    // Bumped after every swap
+    atomic_uint_fast64_t observed;      // Newest generation the input loop has seen
+
+    pthread_t thread;
+    atomic_bool running;
+    struct stat last_stat;
+} ConfigWatcher;
+
+static inline bool config_watch_stat_changed(const struct stat *a, const struct stat *b) {
+    // Editors often save by renaming a new file over the old one, which
+    // changes the inode even when size and mtime (1 s resolution) match
+    return a->st_mtime != b->st_mtime || a->st_size != b->st_size || a->st_ino != b->st_ino;
+}
+
+// Sleep for up to duration_ns, waking early if the watcher is stopped
+static inline void config_watch_sleep(ConfigWatcher *w, uint64_t duration_ns) {
+    uint64_t deadline = monotonic_ns() + duration_ns;
+    while (atomic_load(&w->running) && monotonic_ns() < deadline) {
+        uint64_t step = monotonic_ns() + 10 * NS_PER_MS;
+        sleep_until_ns(step < deadline ? step : deadline);
+    }
+}
+
+static inline void config_watch_publish(ConfigWatcher *w, CompiledProfile *next) {
+    CompiledProfile *old = atomic_exchange(&w->current, next);
+    uint64_t generation = atomic_fetch_add(&w->generation, 1) + 1;
+
+    // Wait for the input loop to pass a quiescent point after the swap;
+    // after that nothing can still be using old. running only goes false
+    // once the input loop has exited, which is just as good.
+    while (atomic_load(&w->running) && atomic_load(&w->observed) < generation) {
+        config_watch_sleep(w, 5 * NS_PER_MS);
+    }
+    free(old);
+}
+
+static inline void *config_watch_thread(void *arg) {
+    ConfigWatcher *w = (ConfigWatcher *)arg;
+
+    while (atomic_load(&w->running)) {
+        config_watch_sleep(w, CONFIG_WATCH_POLL_NS);
+
+        struct stat st;
+        if (stat(w->path, &st) != 0 || !config_watch_stat_changed(&st, &w->last_stat)) {
+            continue;
+        }
+        w->last_stat = st;
+
+        // Parse and compile here, off the input path
+        ControllerMapping config = w->defaults;
+        if (!config_file_load(w->path, &config, w->log)) {
+            continue;
+        }
+        CompiledProfile *next = malloc(sizeof(CompiledProfile));
+        if (!next) {
+            continue;
+        }
+        compile_profile(next, &config);
+        config_watch_publish(w, next);
+        console_log(w->log, "🔄 Reloaded %s\n", w->path);
+    }
+    return NULL;
+}
+
+// Compile the initial mapping and start watching path for changes.
+// config has already been loaded from path by the caller; defaults is what
+// each reload starts from before applying the file. Everything the watcher
+// has to say goes to log, never straight to the terminal.
+static inline bool config_watch_start(ConfigWatcher *w, const char *path,
+                                      const ControllerMapping *defaults,
+                                      const ControllerMapping *config, ConsoleLog *log) {
+    w->path = path;
+    w->log = log;
+    w->defaults = *defaults;
+    if (stat(path, &w->last_stat) != 0) {
+        memset(&w->last_stat, 0, sizeof(w->last_stat));
+    }
+
+    CompiledProfile *initial = malloc(sizeof(CompiledProfile));
+    if (!initial) {
+        return false;
+    }
+    compile_profile(initial, config);
+    atomic_init(&w->current, initial);
+    atomic_init(&w->generation, 0);
+    atomic_init(&w->observed, 0);
+    atomic_init(&w->running, true);
+
+    if (pthread_create(&w->thread, NULL, config_watch_thread, w) != 0) {
+        atomic_store(&w->running, false);
+        free(initial);
+        return false;
+    }
+    return true;
+}
+
+// Input loop side: the mapping to use from now on. Call only where no
+// mapping pointer from an earlier call is still needed afterwards, then
+// report the generation back with config_watch_quiescent().
+static inline CompiledProfile *config_watch_current(ConfigWatcher *w, uint64_t *generation) {
+    *generation = atomic_load(&w->generation);
+    return atomic_load(&w->current);
+}
+
+static inline void config_watch_quiescent(ConfigWatcher *w, uint64_t generation) {
+    atomic_store(&w->observed, generation);
+}
+
+// Stop the thread and free the current mapping. The input loop must no
+// longer be using it.
+static inline void config_watch_stop(ConfigWatcher *w) {
+    atomic_store(&w->running, false);
+    pthread_join(w->thread, NULL);
+    free(atomic_load(&w->current));
+    atomic_store(&w->current, NULL);
+}
+
+#endif // CONFIG_WATCH_H
@@ -0,0 +1,131 @@
+// console.h
+// Console output kept off the input path
+// Threads that handle input never touch stdio. Diagnostics are formatted
+// into a lock-free multi-producer/single-consumer log queue, and the live
+// input display is a per-controller snapshot that the injector overwrites
+// with every packet. A renderer thread prints queued messages and redraws
+// the status line from the snapshots at a fixed low rate, so a slow
+// terminal only ever delays the renderer.
+
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "gip.h"
+
+#define CONSOLE_LOG_SIZE        256     // Queued messages (power of two)
+#define CONSOLE_LINE_MAX        192     // Longer messages are truncated
+#define CONSOLE_REFRESH_HZ      30      // Status line redraws per second
+
+// ============================================================================
+// Log Queue
+// ============================================================================
+
+// Each slot carries a sequence number telling whose turn it is: equal to
+// the producer position when free, position + 1 once filled.
+typedef struct {
+    atomic_uint sequence;
+    char text[CONSOLE_LINE_MAX];
+} ConsoleLogSlot;
+
+typedef struct {
+    ConsoleLogSlot slots[CONSOLE_LOG_SIZE];
+    _Alignas(64) atomic_uint tail;      // Next position to claim (producers)
+    _Alignas(64) unsigned int head;     // Next position to print (renderer)
+    atomic_ulong dropped;               // Messages lost to a full queue
+} ConsoleLog;
+
+static inline void console_log_init(ConsoleLog *log) {
+    for (unsigned int i = 0; i < CONSOLE_LOG_SIZE; i++) {
+        atomic_init(&log->slots[i].sequence, i);
+    }
+    atomic_init(&log->tail, 0);
+    log->head = 0;
+    atomic_init(&log->dropped, 0);
+}
+
+// Queue a printf-style message from any thread. Never blocks; when the
+// queue is full the message is dropped and counted.
+__attribute__((format(printf, 2, 3)))
+static inline void console_log(ConsoleLog *log, const char *format, ...) {
+    unsigned int pos = atomic_load_explicit(&log->tail, memory_order_relaxed);
+    ConsoleLogSlot *slot;
+    for (;;) {
+        slot = &log->slots[pos % CONSOLE_LOG_SIZE];
+        unsigned int sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        int diff = (int)(sequence - pos);
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&log->tail, &pos, pos + 1,
+                                                      memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            atomic_fetch_add_explicit(&log->dropped, 1, memory_order_relaxed);
+            return;
+        } else {
+            pos = atomic_load_explicit(&log->tail, memory_order_relaxed);
+        }
+    }
+
+    va_list args;
+    va_start(args, format);
+    vsnprintf(slot->text, sizeof(slot->text), format, args);
+    va_end(args);
+    atomic_store_explicit(&slot->sequence, pos + 1, memory_order_release);
+}
+
+// Renderer side: copy out the oldest message, if any
+static inline bool console_log_pop(ConsoleLog *log, char *text) {
+    ConsoleLogSlot *slot = &log->slots[log->head % CONSOLE_LOG_SIZE];
+    if (atomic_load_explicit(&slot->sequence, memory_order_acquire) != log->head + 1) {
+        return false;
+    }
+    memcpy(text, slot->text, CONSOLE_LINE_MAX);
+    atomic_store_explicit(&slot->sequence, log->head + CONSOLE_LOG_SIZE, memory_order_release);
+    log->head++;
+    return true;
+}
+
+// ============================================================================
+// Status Snapshots
+// ============================================================================
+
+// Latest input of one controller, written by one thread and read by the
+// renderer. The sequence is odd while an update is in progress; a reader
+// that sees it change retries on its next frame.
+typedef struct {
+    atomic_uint sequence;
+    int input_count;
+    GipInputPacket input;
+} ConsoleStatus;
+
+static inline void console_status_publish(ConsoleStatus *status, int input_count,
+                                          const GipInputPacket *input) {
+    unsigned int sequence = atomic_load_explicit(&status->sequence, memory_order_relaxed);
+    atomic_store_explicit(&status->sequence, sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    status->input_count = input_count;
+    memcpy(&status->input, input, sizeof(*input));
+    atomic_store_explicit(&status->sequence, sequence + 2, memory_order_release);
+}
+
+// Returns false if the snapshot was being written (or never was)
+static inline bool console_status_read(ConsoleStatus *status, int *input_count,
+                                       GipInputPacket *input) {
+    unsigned int before = atomic_load_explicit(&status->sequence, memory_order_acquire);
+    if (before == 0 || (before & 1)) {
+        return false;
+    }
+    *input_count = status->input_count;
+    memcpy(input, &status->input, sizeof(*input));
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit(&status->sequence, memory_order_relaxed) == before;
+}
+
+#endif // CONSOLE_H
@@ -0,0 +1,162 @@
+// controller.h
+// One controller: its USB device and transfers, its own translation
+// pipeline, and its capture/latency bookkeeping. Replayed captures use the
+// same struct without a USB handle, so they behave like extra controllers.
+
+#ifndef CONTROLLER_H
+#define CONTROLLER_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <libusb.h>
+#include "usb_transport.h"
+#include "gip_handshake.h"
+#include "gip_decoder.h"
+#include "mapper.h"
+#include "output_sink.h"
+#include "capture.h"
+#include "latency.h"
+#include "console.h"
+
+#define XBOX_VENDOR_ID  0x045e
+#define XBOX_PRODUCT_ID 0x02dd
+
+#define MAX_CONTROLLERS 8
+
+typedef struct {
+    int number;                     // 1-based, for messages
+    int profile;                    // Which config file this controller follows by default
+    atomic_int selected_profile;    // Chosen over the socket, -1 = automatic
+    bool active;                    // Still delivering input
+
+    // USB (handle is NULL for a replayed or unplugged controller)
+    libusb_device *device;          // Referenced while open
+    libusb_device_handle *handle;
+    uint8_t bus;                    // Where it was last plugged in, so a
+    uint8_t port;                   // replugged controller gets its slot back
+    uint64_t disconnected_ns;       // When it was last unplugged (0 = never)
+    uint8_t in_endpoint;
+    uint8_t out_endpoint;
+    UsbInputEngine engine;
+    UsbOutputQueue output;
+    GipDecoder decoder;
+    GipHandshake handshake;
+    uint8_t out_sequence;           // Sequence number for packets we originate
+    int status;                     // Last battery/status byte (-1 = none yet)
+    uint64_t packet_start_ns;       // When handling of the current packet began
+
+    // Translation: each controller has its own state and frames its own
+    // events; all of them feed one shared sink. With a reader thread these
+    // belong to the injector thread, which only touches attached controllers.
+    bool attached;                  // Injector side: translating its input
+    int following;                  // Config file in use right now
+    Mapper mapper;
+    BatchSink batch;
+
+    LatencyStats latency;
+    CaptureWriter capture;
+    bool capturing;
+    int input_count;
+    ConsoleStatus display;          // Latest input, for the console renderer
+} Controller;
+
+// Collect up to max Xbox controllers currently on the bus (each with a
+// reference held; release with libusb_unref_device)
+static inline int controller_find_all(libusb_context *ctx, libusb_device **found, int max) {
+    libusb_device **list;
+    ssize_t count = libusb_get_device_list(ctx, &list);
+    if (count < 0) {
+        return (int)count;
+    }
+
+    int n = 0;
+    for (ssize_t i = 0; i < count && n < max; i++) {
+        struct libusb_device_descriptor desc;
+        if (libusb_get_device_descriptor(list[i], &desc) == 0 &&
+            desc.idVendor == XBOX_VENDOR_ID && desc.idProduct == XBOX_PRODUCT_ID) {
+            found[n++] = libusb_ref_device(list[i]);
+        }
+    }
+    libusb_free_device_list(list, 1);
+    return n;
+}
+
+// Open the device, claim interface 0 and find its interrupt endpoints,
+// reporting progress to log. Returns 0 on success; on failure nothing is
+// left open.
+static inline int controller_open(Controller *c, libusb_device *device, ConsoleLog *log) {
+    c->bus = libusb_get_bus_number(device);
+    c->port = libusb_get_port_number(device);
+
+    int result = libusb_open(device, &c->handle);
+    if (result < 0) {
+        console_log(log, "❌ Controller %d: failed to open: %s\n", c->number, libusb_error_name(result));
+        c->handle = NULL;
+        return result;
+    }
+
+    // Detach kernel driver
+    if (libusb_kernel_driver_active(c->handle, 0) == 1) {
+        libusb_detach_kernel_driver(c->handle, 0);
+    }
+
+    // Claim interface
+    result = libusb_claim_interface(c->handle, 0);
+    if (result < 0) {
+        console_log(log, "❌ Controller %d: failed to claim interface: %s\n",
+                    c->number, libusb_error_name(result));
+        libusb_close(c->handle);
+        c->handle = NULL;
+        return result;
+    }
+
+    // Get endpoints
+    struct libusb_config_descriptor *desc;
+    result = libusb_get_active_config_descriptor(device, &desc);
+    c->in_endpoint = 0;
+    c->out_endpoint = 0;
+    if (result == 0) {
+        const struct libusb_interface_descriptor *interdesc = &desc->interface[0].altsetting[0];
+        for (int i = 0; i < interdesc->bNumEndpoints; i++) {
+            const struct libusb_endpoint_descriptor *ep = &interdesc->endpoint[i];
+            if ((ep->bmAttributes & 0x03) == LIBUSB_TRANSFER_TYPE_INTERRUPT) {
+                if (ep->bEndpointAddress & LIBUSB_ENDPOINT_IN) {
+                    c->in_endpoint = ep->bEndpointAddress;
+                } else {
+                    c->out_endpoint = ep->bEndpointAddress;
+                }
+            }
+        }
+        libusb_free_config_descriptor(desc);
+    }
+
+    if (c->in_endpoint == 0 || c->out_endpoint == 0) {
+        console_log(log, "❌ Controller %d: could not find interrupt endpoints\n", c->number);
+        libusb_release_interface(c->handle, 0);
+        libusb_close(c->handle);
+        c->handle = NULL;
+        return LIBUSB_ERROR_NOT_FOUND;
+    }
+
+    c->device = libusb_ref_device(device);
+    console_log(log, "✅ Controller %d: claimed (IN 0x%02x, OUT 0x%02x)\n",
+                c->number, c->in_endpoint, c->out_endpoint);
+    return 0;
+}
+
+static inline void controller_close(Controller *c) {
+    if (c->handle) {
+        libusb_release_interface(c->handle, 0);
+        libusb_close(c->handle);
+        c->handle = NULL;
+    }
+    if (c->device) {
+        libusb_unref_device(c->device);
+        c->device = NULL;
+    }
+}
+
+#endif // CONTROLLER_H
@@ -0,0 +1,180 @@
+// frontmost_app.h
+// Which application is in front, for picking profiles automatically
+// A provider answers one question: what is the frontmost application
+// called. A watcher thread polls it and hands changes to the input path,
+// which matches the name against each profile's [profile] apps list.
+//
+// Providers:
+// - macOS: owner of the frontmost normal window in the CoreGraphics window
+//   list (the name the Dock shows, e.g. "Safari")
+// - file: the first line of a file that something else keeps up to date,
+//   e.g. a window manager hook on Linux, or a test
+// Anything with a query function can stand in for them.
+
+#ifndef FRONTMOST_APP_H
+#define FRONTMOST_APP_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <strings.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "keymapping.h"
+#include "timing.h"
+
+#ifdef __APPLE__
+#include <ApplicationServices/ApplicationServices.h>
+#endif
+
+#define FRONTMOST_POLL_NS   (250 * NS_PER_MS)
+
+typedef struct AppProvider AppProvider;
+struct AppProvider {
+    const char *name;
+    // Write the frontmost application's name to name; false if unknown
+    bool (*query)(AppProvider *provider, char *name, size_t size);
+};
+
+// ============================================================================
+// Providers
+// ============================================================================
+
+typedef struct {
+    AppProvider base;
+    const char *path;
+} FileAppProvider;
+
+static inline bool file_app_query(AppProvider *provider, char *name, size_t size) {
+    FileAppProvider *f = (FileAppProvider *)provider;
+    FILE *file = fopen(f->path, "r");
+    if (!file) {
+        return false;
+    }
+    bool found = fgets(name, (int)size, file) != NULL;
+    fclose(file);
+    name[strcspn(name, "\r\n")] = '\0';
+    return found && name[0] != '\0';
+}
+
+static inline void file_app_provider_init(FileAppProvider *f, const char *path) {
+    f->base.name = "file";
+    f->base.query = file_app_query;
+    f->path = path;
+}
+
+#ifdef __APPLE__
+// Windows are listed front to back; layer 0 skips the menu bar, Dock and
+// overlays. Only window owners are read, which needs no permission.
+static inline bool cg_app_query(AppProvider *provider, char *name, size_t size) {
+    (void)provider;
+    CFArrayRef windows = CGWindowListCopyWindowInfo(
+        kCGWindowListOptionOnScreenOnly | kCGWindowListExcludeDesktopElements, kCGNullWindowID);
+    if (!windows) {
+        return false;
+    }
+    bool found = false;
+    for (CFIndex i = 0; i < CFArrayGetCount(windows) && !found; i++) {
+        CFDictionaryRef window = (CFDictionaryRef)CFArrayGetValueAtIndex(windows, i);
+        CFNumberRef layer = (CFNumberRef)CFDictionaryGetValue(window, kCGWindowLayer);
+        int value = -1;
+        if (!layer || !CFNumberGetValue(layer, kCFNumberIntType, &value) || value != 0) {
+            continue;
+        }
+        CFStringRef owner = (CFStringRef)CFDictionaryGetValue(window, kCGWindowOwnerName);
+        found = owner && CFStringGetCString(owner, name, (CFIndex)size, kCFStringEncodingUTF8);
+    }
+    CFRelease(windows);
+    return found;
+}
+
+static inline AppProvider cg_app_provider_make(void) {
+    AppProvider provider = {.name = "window list", .query = cg_app_query};
+    return provider;
+}
+#endif
+
+// Does profile list app? Names compare case-insensitively.
+static inline bool frontmost_app_matches(const ProfileMapping *profile, const char *app) {
+    for (int i = 0; i < profile->app_count; i++) {
+        if (strcasecmp(profile->apps[i], app) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// ============================================================================
+// Watcher
+// ============================================================================
+
+typedef struct {
+    AppProvider *provider;
+    pthread_t thread;
+    atomic_bool running;
+
+    pthread_mutex_t lock;       // Guards name
+    char name[PROFILE_APP_NAME_MAX];    // "" when unknown
+    atomic_uint generation;     // Bumped after name changes
+} FrontmostWatcher;
+
+static inline void *frontmost_watch_thread(void *arg) {
+    FrontmostWatcher *w = (FrontmostWatcher *)arg;
+    char name[PROFILE_APP_NAME_MAX];
+
+    while (atomic_load(&w->running)) {
+        if (!w->provider->query(w->provider, name, sizeof(name))) {
+            name[0] = '\0';
+        }
+        if (strcmp(name, w->name) != 0) {
+            pthread_mutex_lock(&w->lock);
+            strcpy(w->name, name);
+            pthread_mutex_unlock(&w->lock);
+            atomic_fetch_add(&w->generation, 1);
+        }
+
+        // Short steps, so stopping doesn't wait out a whole poll
+        uint64_t deadline = monotonic_ns() + FRONTMOST_POLL_NS;
+        while (atomic_load(&w->running) && monotonic_ns() < deadline) {
+            uint64_t step = monotonic_ns() + 10 * NS_PER_MS;
+            sleep_until_ns(step < deadline ? step : deadline);
+        }
+    }
+    return NULL;
+}
+
+static inline bool frontmost_watch_start(FrontmostWatcher *w, AppProvider *provider) {
+    memset(w, 0, sizeof(*w));
+    w->provider = provider;
+    pthread_mutex_init(&w->lock, NULL);
+    atomic_init(&w->generation, 0);
+    atomic_init(&w->running, true);
+    if (pthread_create(&w->thread, NULL, frontmost_watch_thread, w) != 0) {
+        atomic_store(&w->running, false);
+        pthread_mutex_destroy(&w->lock);
+        return false;
+    }
+    return true;
+}
+
+// Input path side: copy the name into name if it changed since *seen.
+// Never blocks; if the watcher is mid-update this tries again next time.
+static inline bool frontmost_watch_read(FrontmostWatcher *w, unsigned *seen, char *name) {
+    unsigned generation = atomic_load(&w->generation);
+    if (generation == *seen || pthread_mutex_trylock(&w->lock) != 0) {
+        return false;
+    }
+    strcpy(name, w->name);
+    pthread_mutex_unlock(&w->lock);
+    *seen = generation;
+    return true;
+}
+
+static inline void frontmost_watch_stop(FrontmostWatcher *w) {
+    atomic_store(&w->running, false);
+    pthread_join(w->thread, NULL);
+    pthread_mutex_destroy(&w->lock);
+}
+
+#endif // FRONTMOST_APP_H
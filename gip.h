@@ -5,6 +5,7 @@
 #ifndef GIP_H
 #define GIP_H
 
+#include <stdio.h>
 #include <stdint.h>
 
 #pragma pack(push, 1)
@@ -33,13 +34,15 @@ typedef struct {
 } GipInputPacket;
 
 // Rumble packet structure (command 0x09)
+// Magnitudes are 0-100; duration and delay are in 10 ms units
 typedef struct {
     GipHeader header;
-    uint8_t enable;
-    uint8_t magnitude_left;    // Left motor (low frequency)
-    uint8_t magnitude_right;   // Right motor (high frequency)
+    uint8_t unknown;                // Always 0
+    uint8_t motors;                 // GIP_RUMBLE_* mask of motors to drive
     uint8_t magnitude_trigger_left;
     uint8_t magnitude_trigger_right;
+    uint8_t magnitude_left;         // Left motor (strong, low frequency)
+    uint8_t magnitude_right;        // Right motor (weak, high frequency)
     uint8_t duration;
     uint8_t delay;
     uint8_t repeat;
@@ -60,6 +63,20 @@ typedef struct {
 #define GIP_CMD_SERIAL_NUM     0x1E
 #define GIP_CMD_INPUT          0x20
 
+// Header option bits (GipHeader.options)
+#define GIP_OPT_CLIENT_MASK    0x0F    // Client (sub-device) id
+#define GIP_OPT_ACKME          0x10    // Sender wants an acknowledge
+#define GIP_OPT_INTERNAL       0x20    // System message rather than device data
+#define GIP_OPT_CHUNK_START    0x40    // First chunk of a multi-packet message
+#define GIP_OPT_CHUNK          0x80    // Part of a multi-packet message
+
+// Rumble motors (GipRumblePacket.motors)
+#define GIP_RUMBLE_RIGHT       0x01
+#define GIP_RUMBLE_LEFT        0x02
+#define GIP_RUMBLE_TRIGGER_R   0x04
+#define GIP_RUMBLE_TRIGGER_L   0x08
+#define GIP_RUMBLE_ALL         0x0F
+
 // Button bit masks (from GipInputPacket.buttons)
 #define XBOX_BTN_SYNC          0x0001
 #define XBOX_BTN_DUMMY1        0x0002  // Unused
@@ -0,0 +1,265 @@
+// gip_decoder.h
+// GIP message layer: header parsing, per-command dispatch, acknowledges,
+// chunk reassembly and sequence tracking
+// Messages are handed to handlers as pointers into the receive buffer; only
+// multi-packet (chunked) messages are copied, into the reassembly buffer.
+// The decoder does no I/O itself: acknowledges go out through a send
+// callback, so captures can be decoded exactly like live packets.
+//
+// Wire format: command, options, sequence, then the payload length as a
+// 7-bit varint (low bits first, high bit = more). Chunked packets follow
+// with a varint chunk offset; on the first chunk it holds the total length,
+// and an empty chunk at offset == total ends the message.
+
+#ifndef GIP_DECODER_H
+#define GIP_DECODER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "gip.h"
+
+#define GIP_MAX_MESSAGE     4096    // Largest reassembled message
+#define GIP_ACK_SIZE        13
+
+// One decoded message. For single-packet messages packet points at the
+// raw packet; for reassembled ones it is NULL and payload is the buffer.
+typedef struct {
+    uint8_t command;
+    uint8_t options;
+    uint8_t sequence;
+    uint8_t header_length;      // Bytes before the payload in packet
+    const uint8_t *packet;
+    const uint8_t *payload;
+    uint32_t length;            // Payload bytes
+    uint32_t chunk_offset;      // Chunked packets only
+    uint64_t timestamp_ns;      // When the (last) packet arrived
+} GipMessage;
+
+typedef void (*GipHandler)(void *user, const GipMessage *msg);
+typedef void (*GipSendFn)(void *user, const uint8_t *packet, int length);
+
+// Handlers indexed by command byte; NULL entries are counted and ignored
+typedef GipHandler GipDispatchTable[256];
+
+typedef struct {
+    unsigned long packets;
+    unsigned long malformed;    // Truncated or inconsistent packets
+    unsigned long dropped;      // Packets missing from sequence gaps
+    unsigned long duplicates;   // Same sequence twice (resent for lack of an ack)
+    unsigned long acks;         // Acknowledges sent
+    unsigned long reassembled;  // Chunked messages completed
+    unsigned long unhandled;    // No handler for the command
+} GipStats;
+
+typedef struct {
+    const GipHandler *table;
+    GipSendFn send;
+    void *user;
+
+    // Last sequence seen per command (0 = none yet). Sequences run 1-255.
+    uint8_t last_sequence[256];
+    GipStats stats;
+
+    // Reassembly of one chunked message at a time
+    bool chunk_active;
+    uint8_t chunk_command;
+    uint8_t chunk_options;
+    uint32_t chunk_total;
+    uint32_t chunk_received;
+    uint8_t chunk_buffer[GIP_MAX_MESSAGE];
+} GipDecoder;
+
+static inline void gip_decoder_init(GipDecoder *d, const GipHandler *table,
+                                    GipSendFn send, void *user) {
+    memset(d, 0, sizeof(*d));
+    d->table = table;
+    d->send = send;
+    d->user = user;
+}
+
+// Forget sequences and any partial message (the controller restarted its
+// session); statistics are kept
+static inline void gip_decoder_reset(GipDecoder *d) {
+    memset(d->last_sequence, 0, sizeof(d->last_sequence));
+    d->chunk_active = false;
+}
+
+static inline uint16_t gip_le16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+// Returns bytes consumed, or -1 if the varint runs past the buffer
+static inline int gip_read_varint(const uint8_t *p, int available, uint32_t *value) {
+    *value = 0;
+    for (int i = 0; i < available && i < 4; i++) {
+        *value |= (uint32_t)(p[i] & 0x7F) << (i * 7);
+        if (!(p[i] & 0x80)) {
+            return i + 1;
+        }
+    }
+    return -1;
+}
+
+// Parse one packet's header. Returns false if it is truncated.
+static inline bool gip_parse(const uint8_t *data, int length, uint64_t timestamp_ns,
+                             GipMessage *msg) {
+    if (length < (int)sizeof(GipHeader)) {
+        return false;
+    }
+    msg->command = data[0];
+    msg->options = data[1];
+    msg->sequence = data[2];
+    msg->chunk_offset = 0;
+    msg->timestamp_ns = timestamp_ns;
+
+    int pos = 3;
+    int used = gip_read_varint(data + pos, length - pos, &msg->length);
+    if (used < 0) {
+        return false;
+    }
+    pos += used;
+    if (msg->options & GIP_OPT_CHUNK) {
+        used = gip_read_varint(data + pos, length - pos, &msg->chunk_offset);
+        if (used < 0) {
+            return false;
+        }
+        pos += used;
+    }
+    if ((uint32_t)(length - pos) < msg->length) {
+        return false;
+    }
+
+    msg->header_length = (uint8_t)pos;
+    msg->packet = data;
+    msg->payload = data + pos;
+    return true;
+}
+
+// Acknowledge msg: acked is how much of the message has arrived, remaining
+// how much is still to come (chunked messages)
+static inline void gip_send_ack(GipDecoder *d, const GipMessage *msg,
+                                uint32_t acked, uint32_t remaining) {
+    uint8_t options = GIP_OPT_INTERNAL | (msg->options & GIP_OPT_CLIENT_MASK);
+    uint8_t ack[GIP_ACK_SIZE] = {
+        GIP_CMD_ACKNOWLEDGE, options, msg->sequence, 0x09,
+        0x00, msg->command, options,
+        (uint8_t)acked, (uint8_t)(acked >> 8),
+        0x00, 0x00,
+        (uint8_t)remaining, (uint8_t)(remaining >> 8)
+    };
+    d->stats.acks++;
+    if (d->send) {
+        d->send(d->user, ack, sizeof(ack));
+    }
+}
+
+// Count packets missing between the last sequence for this command and seq
+static inline void gip_track_sequence(GipDecoder *d, uint8_t command, uint8_t sequence) {
+    if (sequence == 0) {
+        return;     // Not numbered
+    }
+    uint8_t last = d->last_sequence[command];
+    d->last_sequence[command] = sequence;
+    if (last == 0) {
+        return;
+    }
+    if (sequence == last) {
+        d->stats.duplicates++;
+        return;
+    }
+    // Distance on the 1..255 ring; a big jump backwards is a restart or
+    // reordering rather than 200 lost packets
+    int gap = ((int)sequence - (int)last + 255) % 255 - 1;
+    if (gap > 0 && gap < 128) {
+        d->stats.dropped += (unsigned long)gap;
+    }
+}
+
+static inline void gip_dispatch(GipDecoder *d, const GipMessage *msg) {
+    GipHandler handler = d->table[msg->command];
+    if (handler) {
+        handler(d->user, msg);
+    } else {
+        d->stats.unhandled++;
+    }
+}
+
+// Add one chunk to the message being reassembled; dispatches it once the
+// end marker arrives
+static inline void gip_decode_chunk(GipDecoder *d, const GipMessage *msg) {
+    uint32_t end = msg->chunk_offset + msg->length;
+
+    if (msg->options & GIP_OPT_CHUNK_START) {
+        // The first chunk carries the total length in its offset field
+        d->chunk_active = msg->chunk_offset <= GIP_MAX_MESSAGE && msg->length <= msg->chunk_offset;
+        if (!d->chunk_active) {
+            d->stats.malformed++;
+            return;
+        }
+        d->chunk_command = msg->command;
+        d->chunk_options = msg->options;
+        d->chunk_total = msg->chunk_offset;
+        memcpy(d->chunk_buffer, msg->payload, msg->length);
+        d->chunk_received = msg->length;
+        end = msg->length;
+    } else if (!d->chunk_active || msg->command != d->chunk_command || end > d->chunk_total) {
+        d->stats.malformed++;
+        return;
+    } else if (msg->length > 0) {
+        memcpy(d->chunk_buffer + msg->chunk_offset, msg->payload, msg->length);
+        d->chunk_received += msg->length;
+    }
+
+    if (msg->options & GIP_OPT_ACKME) {
+        gip_send_ack(d, msg, end, d->chunk_total - end);
+    }
+
+    bool end_marker = !(msg->options & GIP_OPT_CHUNK_START) && msg->length == 0;
+    if (end_marker && msg->chunk_offset == d->chunk_total) {
+        d->chunk_active = false;
+        if (d->chunk_received != d->chunk_total) {
+            d->stats.malformed++;
+            return;
+        }
+        GipMessage whole = *msg;
+        whole.options = d->chunk_options & ~(GIP_OPT_CHUNK | GIP_OPT_CHUNK_START);
+        whole.packet = NULL;
+        whole.header_length = 0;
+        whole.payload = d->chunk_buffer;
+        whole.length = d->chunk_total;
+        whole.chunk_offset = 0;
+        d->stats.reassembled++;
+        gip_dispatch(d, &whole);
+    }
+}
+
+// Decode one received packet: track its sequence, acknowledge it if asked
+// to, and hand it (or the message it completes) to its handler
+static inline void gip_decode(GipDecoder *d, const uint8_t *data, int length,
+                              uint64_t timestamp_ns) {
+    GipMessage msg;
+    d->stats.packets++;
+    if (!gip_parse(data, length, timestamp_ns, &msg)) {
+        d->stats.malformed++;
+        return;
+    }
+    // The chunks of one message share its sequence number
+    if (!(msg.options & GIP_OPT_CHUNK) || (msg.options & GIP_OPT_CHUNK_START)) {
+        gip_track_sequence(d, msg.command, msg.sequence);
+    }
+
+    if (msg.options & GIP_OPT_CHUNK) {
+        gip_decode_chunk(d, &msg);
+        return;
+    }
+
+    // This controller also expects its announce to be acknowledged even
+    // though the announce doesn't ask for it
+    if ((msg.options & GIP_OPT_ACKME) || msg.command == GIP_CMD_ANNOUNCE) {
+        gip_send_ack(d, &msg, msg.length, 0);
+    }
+    gip_dispatch(d, &msg);
+}
+
+#endif // GIP_DECODER_H
@@ -0,0 +1,98 @@
+// gip_handshake.h
+// GIP start-up handshake as a state machine driven by incoming packets
+// Power-on goes out as soon as the controller is claimed. Each announce
+// (acknowledged by the decoder as it arrives) is followed by a fresh
+// power-on, since an announce means the controller (re)started its
+// session. The first input report marks the controller ready. Timers only
+// matter when packets don't come: power-on is repeated a few times, then
+// the handshake stops retrying. Input is translated in every state; the
+// handshake only decides what to send.
+//
+// No I/O happens here: each step returns the actions for the caller to
+// carry out.
+
+#ifndef GIP_HANDSHAKE_H
+#define GIP_HANDSHAKE_H
+
+#include <stdint.h>
+#include "gip.h"
+#include "timing.h"
+
+#define GIP_HANDSHAKE_RETRY_NS      (250 * NS_PER_MS)   // Repeat power-on this often
+#define GIP_HANDSHAKE_MAX_ATTEMPTS  8                   // Power-ons before giving up
+
+typedef enum {
+    GIP_HANDSHAKE_IDLE,         // Not handshaking (replayed controller)
+    GIP_HANDSHAKE_POWERING_ON,  // Power-on sent, waiting for the first input
+    GIP_HANDSHAKE_READY         // Input is flowing
+} GipHandshakeState;
+
+// Actions returned by the step functions (bit mask)
+#define GIP_ACTION_SEND_POWER_ON    0x01
+#define GIP_ACTION_READY            0x02    // First input report arrived
+#define GIP_ACTION_GAVE_UP          0x04    // No input after every power-on attempt
+
+typedef struct {
+    GipHandshakeState state;
+    uint64_t started_ns;        // When the controller was picked up
+    uint64_t ready_ns;          // Arrival of the first input (0 = none yet)
+    uint64_t retry_ns;          // When to repeat power-on
+    int attempts;               // Power-ons sent since the last (re)start
+    int announces;
+} GipHandshake;
+
+static inline unsigned gip_handshake_power_on(GipHandshake *h, uint64_t now_ns) {
+    h->state = GIP_HANDSHAKE_POWERING_ON;
+    h->attempts++;
+    h->retry_ns = now_ns + GIP_HANDSHAKE_RETRY_NS;
+    return GIP_ACTION_SEND_POWER_ON;
+}
+
+// Begin with a controller that was just claimed; started_ns is when it
+// arrived, so time-to-first-input includes opening it
+static inline unsigned gip_handshake_start(GipHandshake *h, uint64_t started_ns, uint64_t now_ns) {
+    h->started_ns = started_ns;
+    h->ready_ns = 0;
+    h->attempts = 0;
+    h->announces = 0;
+    return gip_handshake_power_on(h, now_ns);
+}
+
+// Feed every packet received from the controller
+static inline unsigned gip_handshake_packet(GipHandshake *h, const GipHeader *header,
+                                            uint64_t timestamp_ns) {
+    if (h->state == GIP_HANDSHAKE_IDLE) {
+        return 0;
+    }
+
+    if (header->command == GIP_CMD_ANNOUNCE) {
+        h->announces++;
+        h->attempts = 0;
+        unsigned actions = gip_handshake_power_on(h, timestamp_ns);
+        if (h->ready_ns) {
+            h->state = GIP_HANDSHAKE_READY;     // Already running; just re-power
+        }
+        return actions;
+    }
+
+    if (header->command == GIP_CMD_INPUT && h->state == GIP_HANDSHAKE_POWERING_ON) {
+        h->state = GIP_HANDSHAKE_READY;
+        h->ready_ns = timestamp_ns;
+        return GIP_ACTION_READY;
+    }
+    return 0;
+}
+
+// Call regularly; only does something while waiting for the first input
+static inline unsigned gip_handshake_timer(GipHandshake *h, uint64_t now_ns) {
+    if (h->state != GIP_HANDSHAKE_POWERING_ON || now_ns < h->retry_ns) {
+        return 0;
+    }
+    if (h->attempts >= GIP_HANDSHAKE_MAX_ATTEMPTS) {
+        h->retry_ns = UINT64_MAX;   // Keep listening for a late first input
+        return GIP_ACTION_GAVE_UP;
+    }
+    return gip_handshake_power_on(h, now_ns);
+}
+
+#endif // GIP_HANDSHAKE_H
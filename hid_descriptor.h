@@ -1,11 +1,13 @@
 // hid_descriptor.h
 // HID Report Descriptor for Xbox One Controller
-// This tells macOS what our virtual gamepad looks like
+// This tells the OS what our virtual gamepad looks like (used by the uhid
+// sink on Linux; macOS doesn't let userspace create HID devices)
 
 #ifndef HID_DESCRIPTOR_H
 #define HID_DESCRIPTOR_H
 
 #include <stdint.h>
+#include "gip.h"
 
 // HID Report Descriptor for a standard gamepad
 // This matches the Xbox controller layout
@@ -66,7 +68,7 @@ static const uint8_t gamepad_hid_descriptor[] = {
 #define GAMEPAD_HID_DESCRIPTOR_SIZE sizeof(gamepad_hid_descriptor)
 
 // HID Report structure matching the descriptor above
-// This is the data we'll send to macOS
+// This is the data the virtual gamepad sends
 #pragma pack(push, 1)
 typedef struct {
     uint16_t buttons;      // 16 buttons (bit field)
@@ -82,4 +84,28 @@ typedef struct {
 // Size check - should be 12 bytes
 _Static_assert(sizeof(GamepadReport) == 12, "GamepadReport must be 12 bytes");
 
+// GIP input packet -> report, no deadzone or curve: the game gets the raw
+// values. Only a fixed reshuffle:
+// - buttons are moved into the descriptor's order with shifts (Guide and
+//   Share arrive in other packets and stay 0)
+// - the triggers and the stick axes are swapped back (see mapper.h: GIP
+//   reports physical up/down in the X field and the triggers reversed)
+// - Y is flipped to HID's down-positive convention; ~y maps -32768..32767
+//   onto 32767..-32768 without overflowing
+static inline void gamepad_report_from_gip(const GipInputPacket *input, GamepadReport *report) {
+    uint16_t b = input->buttons;
+    report->buttons = (uint16_t)(((b >> 4) & 0x000F) |     // A B X Y
+                                 ((b >> 8) & 0x0030) |     // LB RB
+                                 ((b << 3) & 0x0040) |     // View
+                                 ((b << 5) & 0x0080) |     // Menu
+                                 ((b >> 6) & 0x0300) |     // LS RS
+                                 ((b << 2) & 0x3C00));     // D-pad up, down, left, right
+    report->left_trigger = input->right_trigger;
+    report->right_trigger = input->left_trigger;
+    report->left_stick_x = input->left_stick_y;
+    report->left_stick_y = (int16_t)~input->left_stick_x;
+    report->right_stick_x = input->right_stick_y;
+    report->right_stick_y = (int16_t)~input->right_stick_x;
+}
+
 #endif // HID_DESCRIPTOR_H
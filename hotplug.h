@@ -0,0 +1,126 @@
+// hotplug.h
+// Controller attach/detach notifications
+// libusb reports hot-plug events from inside its event handling, where a
+// device can't be opened and handshaken, so the callback only queues them
+// and the input loop applies them between packets. Where libusb has no
+// hot-plug support, a periodic rescan produces the same arrival events
+// (departures then show up as failed transfers).
+
+#ifndef HOTPLUG_H
+#define HOTPLUG_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <libusb.h>
+#include "controller.h"
+#include "timing.h"
+
+#define HOTPLUG_QUEUE_SIZE      16                  // Pending events (power of two)
+#define HOTPLUG_RESCAN_NS       (250 * NS_PER_MS)   // Fallback polling interval
+
+typedef enum {
+    HOTPLUG_ARRIVED,
+    HOTPLUG_LEFT
+} HotplugEventType;
+
+typedef struct {
+    HotplugEventType type;
+    libusb_device *device;      // Holds a reference; release with libusb_unref_device
+} HotplugEvent;
+
+typedef struct {
+    libusb_context *ctx;
+    bool registered;            // libusb delivers events; otherwise we rescan
+    libusb_hotplug_callback_handle callback;
+
+    HotplugEvent queue[HOTPLUG_QUEUE_SIZE];
+    unsigned int queue_head;
+    unsigned int queue_tail;
+    unsigned long dropped;
+
+    uint64_t next_scan_ns;      // 0 = no rescan scheduled
+} HotplugMonitor;
+
+static inline void hotplug_push(HotplugMonitor *mon, HotplugEventType type, libusb_device *device) {
+    if (mon->queue_tail - mon->queue_head == HOTPLUG_QUEUE_SIZE) {
+        mon->dropped++;
+        return;
+    }
+    HotplugEvent *event = &mon->queue[mon->queue_tail % HOTPLUG_QUEUE_SIZE];
+    event->type = type;
+    event->device = libusb_ref_device(device);
+    mon->queue_tail++;
+}
+
+static inline int LIBUSB_CALL hotplug_callback(libusb_context *ctx, libusb_device *device,
+                                               libusb_hotplug_event event, void *user_data) {
+    (void)ctx;
+    HotplugMonitor *mon = (HotplugMonitor *)user_data;
+    hotplug_push(mon, event == LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED ? HOTPLUG_ARRIVED : HOTPLUG_LEFT,
+                 device);
+    return 0;   // Stay registered
+}
+
+// Start listening. Controllers already plugged in are reported as arrivals
+// on the first hotplug_next() either way.
+static inline void hotplug_start(HotplugMonitor *mon, libusb_context *ctx) {
+    memset(mon, 0, sizeof(*mon));
+    mon->ctx = ctx;
+
+    if (libusb_has_capability(LIBUSB_CAP_HAS_HOTPLUG)) {
+        int result = libusb_hotplug_register_callback(
+            ctx, LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED | LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT,
+            LIBUSB_HOTPLUG_ENUMERATE, XBOX_VENDOR_ID, XBOX_PRODUCT_ID,
+            LIBUSB_HOTPLUG_MATCH_ANY, hotplug_callback, mon, &mon->callback);
+        mon->registered = (result == LIBUSB_SUCCESS);
+    }
+    if (!mon->registered) {
+        mon->next_scan_ns = monotonic_ns();
+    }
+}
+
+// Ask for a rescan after delay_ns, e.g. when a controller that just arrived
+// couldn't be opened yet
+static inline void hotplug_rescan_after(HotplugMonitor *mon, uint64_t delay_ns) {
+    uint64_t at = monotonic_ns() + delay_ns;
+    if (mon->next_scan_ns == 0 || at < mon->next_scan_ns) {
+        mon->next_scan_ns = at;
+    }
+}
+
+// Next pending event, if any. Arrivals from a rescan include controllers
+// that are already open; the caller skips those.
+static inline bool hotplug_next(HotplugMonitor *mon, HotplugEvent *event) {
+    if (mon->next_scan_ns != 0 && monotonic_ns() >= mon->next_scan_ns) {
+        libusb_device *found[MAX_CONTROLLERS];
+        int count = controller_find_all(mon->ctx, found, MAX_CONTROLLERS);
+        for (int i = 0; i < count; i++) {
+            hotplug_push(mon, HOTPLUG_ARRIVED, found[i]);
+            libusb_unref_device(found[i]);
+        }
+        mon->next_scan_ns = mon->registered ? 0 : monotonic_ns() + HOTPLUG_RESCAN_NS;
+    }
+
+    if (mon->queue_head == mon->queue_tail) {
+        return false;
+    }
+    *event = mon->queue[mon->queue_head % HOTPLUG_QUEUE_SIZE];
+    mon->queue_head++;
+    return true;
+}
+
+static inline void hotplug_stop(HotplugMonitor *mon) {
+    if (mon->registered) {
+        libusb_hotplug_deregister_callback(mon->ctx, mon->callback);
+        mon->registered = false;
+    }
+    HotplugEvent event;
+    mon->next_scan_ns = 0;
+    while (hotplug_next(mon, &event)) {
+        libusb_unref_device(event.device);
+    }
+}
+
+#endif // HOTPLUG_H
@@ -0,0 +1,197 @@
+// input_ring.h
+// Hand-off from the USB reader thread to the injector thread
+// A lock-free single-producer/single-consumer ring of controller snapshots.
+// The reader never waits for the injector: when the ring is full, events go
+// to a reader-side backlog, and a new snapshot that only moves the sticks is
+// merged into that controller's latest waiting snapshot. Button and trigger
+// changes always get their own entry: the trigger threshold belongs to the
+// mapping, which can differ per controller and change at any time, so no
+// trigger movement is assumed to be edge-free. Only if the backlog fills up
+// with these too does the reader wait for the injector.
+//
+// The injector sleeps on a condition variable when the ring is empty; the
+// reader only touches the mutex when the injector is actually asleep.
+
+#ifndef INPUT_RING_H
+#define INPUT_RING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "gip.h"
+#include "timing.h"
+
+#define INPUT_RING_SIZE     256     // Events in flight (power of two)
+#define INPUT_BACKLOG_SIZE  64      // Reader-side overflow when the ring is full
+
+typedef enum {
+    INPUT_EVENT_PACKET,         // Input snapshot
+    INPUT_EVENT_CONNECTED,      // Controller (re)connected: start translating
+    INPUT_EVENT_DISCONNECTED    // Controller gone: release what it holds
+} InputEventType;
+
+typedef struct {
+    uint8_t type;
+    uint8_t controller;         // Index into the controller table
+    uint16_t merged;            // Snapshots folded into this one
+    uint64_t complete_ns;       // USB transfer completed
+    uint64_t start_ns;          // Reader started handling it
+    uint64_t decoded_ns;        // Reader handed it over
+    GipInputPacket input;
+} InputEvent;
+
+typedef struct {
+    InputEvent events[INPUT_RING_SIZE];
+
+    // Indices on separate cache lines so the two threads don't contend
+    _Alignas(64) atomic_uint head;      // Next to read (injector)
+    _Alignas(64) atomic_uint tail;      // Next to write (reader)
+
+    // Reader side only
+    _Alignas(64) InputEvent backlog[INPUT_BACKLOG_SIZE];
+    unsigned int backlog_count;
+    unsigned long merged;       // Snapshots merged under backpressure
+    unsigned long stalls;       // Times the reader had to wait
+
+    // Waking a sleeping injector
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    atomic_bool waiting;
+} InputRing;
+
+static inline void input_ring_init(InputRing *r) {
+    memset(r, 0, sizeof(*r));
+    atomic_init(&r->head, 0);
+    atomic_init(&r->tail, 0);
+    atomic_init(&r->waiting, false);
+    pthread_mutex_init(&r->lock, NULL);
+    pthread_cond_init(&r->wake, NULL);
+}
+
+static inline void input_ring_destroy(InputRing *r) {
+    pthread_mutex_destroy(&r->lock);
+    pthread_cond_destroy(&r->wake);
+}
+
+// ============================================================================
+// Injector Side
+// ============================================================================
+
+static inline bool input_ring_pop(InputRing *r, InputEvent *event) {
+    unsigned int head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    if (head == atomic_load_explicit(&r->tail, memory_order_acquire)) {
+        return false;
+    }
+    *event = r->events[head % INPUT_RING_SIZE];
+    atomic_store_explicit(&r->head, head + 1, memory_order_release);
+    return true;
+}
+
+// Sleep until the reader publishes something or deadline_ns passes
+static inline void input_ring_wait(InputRing *r, uint64_t deadline_ns) {
+    uint64_t now = monotonic_ns();
+    if (deadline_ns <= now) {
+        return;
+    }
+
+    // Condition variables time out on the wall clock
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    uint64_t wake_at = (uint64_t)ts.tv_sec * NS_PER_SEC + ts.tv_nsec + (deadline_ns - now);
+    ts.tv_sec = wake_at / NS_PER_SEC;
+    ts.tv_nsec = wake_at % NS_PER_SEC;
+
+    pthread_mutex_lock(&r->lock);
+    atomic_store(&r->waiting, true);
+    // Checked after announcing we're waiting, so a push that missed the
+    // flag is seen here
+    if (atomic_load(&r->head) == atomic_load(&r->tail)) {
+        pthread_cond_timedwait(&r->wake, &r->lock, &ts);
+    }
+    atomic_store(&r->waiting, false);
+    pthread_mutex_unlock(&r->lock);
+}
+
+// ============================================================================
+// Reader Side
+// ============================================================================
+
+static inline void input_ring_wake(InputRing *r) {
+    if (atomic_load(&r->waiting)) {
+        pthread_mutex_lock(&r->lock);
+        pthread_cond_signal(&r->wake);
+        pthread_mutex_unlock(&r->lock);
+    }
+}
+
+static inline bool input_ring_push(InputRing *r, const InputEvent *event) {
+    unsigned int tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    if (tail - atomic_load_explicit(&r->head, memory_order_acquire) == INPUT_RING_SIZE) {
+        return false;
+    }
+    r->events[tail % INPUT_RING_SIZE] = *event;
+    atomic_store(&r->tail, tail + 1);
+    return true;
+}
+
+// Move backlogged events into the ring as space allows, oldest first.
+// Returns true once the backlog is empty.
+static inline bool input_ring_flush(InputRing *r) {
+    unsigned int moved = 0;
+    while (moved < r->backlog_count && input_ring_push(r, &r->backlog[moved])) {
+        moved++;
+    }
+    if (moved > 0) {
+        memmove(r->backlog, r->backlog + moved, (r->backlog_count - moved) * sizeof(InputEvent));
+        r->backlog_count -= moved;
+        input_ring_wake(r);
+    }
+    return r->backlog_count == 0;
+}
+
+// Can newer replace older without losing a button or trigger edge?
+static inline bool input_ring_mergeable(const InputEvent *older, const InputEvent *newer) {
+    return older->type == INPUT_EVENT_PACKET && newer->type == INPUT_EVENT_PACKET &&
+           older->input.buttons == newer->input.buttons &&
+           older->input.left_trigger == newer->input.left_trigger &&
+           older->input.right_trigger == newer->input.right_trigger;
+}
+
+// Publish one event. Never blocks unless the backlog is full of events that
+// can't be merged.
+static inline void input_ring_send(InputRing *r, const InputEvent *event) {
+    if (input_ring_flush(r) && input_ring_push(r, event)) {
+        input_ring_wake(r);
+        return;
+    }
+
+    // Ring full: fold an analog-only update into this controller's latest
+    // waiting snapshot
+    for (int i = (int)r->backlog_count - 1; i >= 0; i--) {
+        InputEvent *waiting = &r->backlog[i];
+        if (waiting->controller != event->controller) {
+            continue;
+        }
+        if (input_ring_mergeable(waiting, event)) {
+            uint16_t merged = waiting->merged;
+            *waiting = *event;
+            waiting->merged = merged + event->merged + 1;
+            r->merged++;
+            return;
+        }
+        break;
+    }
+
+    while (r->backlog_count == INPUT_BACKLOG_SIZE) {
+        r->stalls++;
+        sleep_until_ns(monotonic_ns() + 100000);
+        input_ring_flush(r);
+    }
+    r->backlog[r->backlog_count++] = *event;
+}
+
+#endif // INPUT_RING_H
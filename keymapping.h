@@ -22,6 +22,9 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include "gip.h"
 
 /*******************************************************************************
  * SECTION 1: STICK BEHAVIOR
@@ -39,6 +42,16 @@ typedef enum {
     STICK_MODE_DISABLED
 } StickMode;
 
+// How a stick in WASD or ARROWS mode picks its keys:
+// - KEY_DIRECTIONS_AXES: up/down and left/right each on their own
+// - KEY_DIRECTIONS_4:    by direction, one of four keys at a time
+// - KEY_DIRECTIONS_8:    by direction, one key or a diagonal pair
+typedef enum {
+    KEY_DIRECTIONS_AXES,
+    KEY_DIRECTIONS_4,
+    KEY_DIRECTIONS_8
+} KeyDirections;
+
 /*******************************************************************************
  * SECTION 2: TRIGGER BEHAVIOR
  * 
@@ -53,6 +66,61 @@ typedef enum {
     TRIGGER_MODE_DISABLED
 } TriggerMode;
 
+/*******************************************************************************
+ * SECTION 3: MOUSE RESPONSE CURVE
+ * 
+ * Choose how stick deflection maps to mouse speed:
+ * - MOUSE_CURVE_POWER:     speed = deflection ^ mouse_curve
+ * - MOUSE_CURVE_PIECEWISE: straight lines through your points
+ * - MOUSE_CURVE_BEZIER:    smooth curve using your points as control points
+ ******************************************************************************/
+typedef enum {
+    MOUSE_CURVE_POWER,
+    MOUSE_CURVE_PIECEWISE,
+    MOUSE_CURVE_BEZIER
+} MouseCurveType;
+
+#define MOUSE_CURVE_MAX_POINTS 8
+
+/*******************************************************************************
+ * SECTION 4: ACTIONS (combos, tap/hold, turbo, macros)
+ * 
+ * An action is bound to one button, or to several pressed together (a
+ * chord, e.g. LB+A), and replaces the plain key of a single button:
+ * - ACTION_KEY:      Hold a key while the button(s) are held
+ * - ACTION_TAP_HOLD: A quick press taps key; holding for hold_ms holds hold_key
+ * - ACTION_TURBO:    Tap key rate_hz times per second while held
+ * - ACTION_MACRO:    Play a timed key sequence once per press
+ ******************************************************************************/
+typedef enum {
+    ACTION_KEY,
+    ACTION_TAP_HOLD,
+    ACTION_TURBO,
+    ACTION_MACRO
+} ActionType;
+
+#define ACTION_MAX          16
+#define ACTION_MACRO_MAX    16
+#define ACTION_NO_KEY       0xFFFF      // Macro step that only waits
+
+/*******************************************************************************
+ * SECTION 5: LAYERS AND PROFILES
+ * 
+ * A layer is active while its button(s) are held and changes some of the
+ * settings above (e.g. hold LB to aim: lower mouse_sensitivity and other
+ * face-button keys). Layers stack: when several are active, the later one
+ * wins where they change the same setting. Layer buttons only switch
+ * layers, they send nothing themselves.
+ * 
+ * A profile is one config file (see controller.conf.example). Profiles can
+ * be picked at runtime, or automatically by the frontmost application.
+ ******************************************************************************/
+#define LAYER_MAX           4
+#define LAYER_OVERRIDE_MAX  24
+#define LAYER_NAME_MAX      16
+#define PROFILE_APPS_MAX    8
+#define PROFILE_APP_NAME_MAX 64
+
 /*******************************************************************************
  * INTERNAL STRUCTURES (Don't modify these, edit the config below instead)
  ******************************************************************************/
@@ -74,7 +142,22 @@ typedef struct {
     float mouse_sensitivity;
     float mouse_curve;
     float mouse_smoothing;
+    MouseCurveType mouse_curve_type;
+    uint8_t mouse_curve_point_count;
+    float mouse_curve_points[MOUSE_CURVE_MAX_POINTS][2];   // {deflection, speed}, 0.0-1.0
     int16_t deadzone;
+    
+    // Key-mode sticks (WASD/ARROWS)
+    uint16_t pwm_hz;            // Pulse keys in proportion to tilt; 0 = plain on/off
+    uint16_t walk_key;
+    float walk_below;           // Hold walk_key below this tilt (0.0-1.0), 0 = never
+    uint16_t run_key;
+    float run_above;            // Hold run_key from this tilt (0.0-1.0), 0 = never
+    KeyDirections key_directions;
+    float key_press;            // Tilt that presses a key (0.0-1.0)
+    float key_release;          // Tilt it's released below, up to key_press
+    float sector_overlap;       // Degrees a held direction reaches into its neighbours
+    uint16_t snapback_ms;       // Ignore the opposite key this long after a release
 } StickMapping;
 
 typedef struct {
@@ -85,14 +168,93 @@ typedef struct {
     uint8_t threshold;
 } TriggerMapping;
 
+typedef struct {
+    uint16_t key;               // Or ACTION_NO_KEY
+    uint16_t hold_ms;           // How long the key stays down (or the wait)
+} MacroStep;
+
+typedef struct {
+    uint16_t buttons;           // XBOX_BTN_* mask: one button, or several for a chord
+    ActionType type;
+    uint16_t key;               // KEY and TURBO; the tap key for TAP_HOLD
+    uint16_t hold_key;          // TAP_HOLD
+    uint16_t hold_ms;           // TAP_HOLD: how long a press must last to count as a hold
+    uint16_t rate_hz;           // TURBO
+    uint8_t step_count;         // MACRO
+    MacroStep steps[ACTION_MACRO_MAX];
+} ActionMapping;
+
+typedef struct {
+    uint16_t chord_window_ms;   // How long a chord button waits for the rest
+    uint8_t count;
+    ActionMapping list[ACTION_MAX];
+} ActionsMapping;
+
+// One setting a layer changes: the bytes of a ControllerMapping member
+typedef struct {
+    uint16_t offset;            // Into ControllerMapping
+    uint8_t size;
+    uint8_t value[8];
+} LayerOverride;
+
+typedef struct {
+    char name[LAYER_NAME_MAX];
+    uint16_t buttons;           // XBOX_BTN_* mask, all held to activate
+    uint8_t override_count;
+    LayerOverride overrides[LAYER_OVERRIDE_MAX];
+} LayerMapping;
+
+// Where layer keeps its setting at offset: the existing override, or a new
+// one. NULL when all LAYER_OVERRIDE_MAX are taken by other settings.
+static inline LayerOverride *layer_override_slot(LayerMapping *layer, size_t offset) {
+    for (int i = 0; i < layer->override_count; i++) {
+        if (layer->overrides[i].offset == offset) {
+            return &layer->overrides[i];
+        }
+    }
+    if (layer->override_count == LAYER_OVERRIDE_MAX) {
+        return NULL;
+    }
+    return &layer->overrides[layer->override_count++];
+}
+
+typedef struct {
+    uint8_t count;
+    LayerMapping list[LAYER_MAX];
+} LayersMapping;
+
+typedef struct {
+    uint8_t app_count;          // Applications that select this profile
+    char apps[PROFILE_APPS_MAX][PROFILE_APP_NAME_MAX];
+} ProfileMapping;
+
 typedef struct {
     ButtonMapping buttons;
     StickMapping sticks;
     TriggerMapping triggers;
+    ActionsMapping actions;
+    LayersMapping layers;
+    ProfileMapping profile;
     bool console_output_enabled;
     bool streaming_mode;
+    uint8_t usb_transfers;
+    uint16_t output_rate_hz;
 } ControllerMapping;
 
+// Make layer change member (e.g. sticks.mouse_sensitivity) to value. Setting
+// the same member again replaces the value; settings past LAYER_OVERRIDE_MAX
+// are ignored.
+#define LAYER_SET(layer, member, v) do { \
+        __typeof__(((ControllerMapping *)0)->member) value_ = (v); \
+        LayerOverride *override_ = \
+            layer_override_slot((layer), offsetof(ControllerMapping, member)); \
+        if (override_) { \
+            override_->offset = offsetof(ControllerMapping, member); \
+            override_->size = sizeof(value_); \
+            memcpy(override_->value, &value_, sizeof(value_)); \
+        } \
+    } while (0)
+
 /*******************************************************************************
  * ============================================================================
  *                    🎮 YOUR CONFIGURATION STARTS HERE 🎮
@@ -104,7 +266,7 @@ typedef struct {
  ******************************************************************************/
 
 static inline ControllerMapping get_default_mapping(void) {
-    ControllerMapping mapping;
+    ControllerMapping mapping = {0};
     
     /***************************************************************************
      * BUTTON MAPPINGS
@@ -202,6 +364,29 @@ static inline ControllerMapping get_default_mapping(void) {
     mapping.sticks.mouse_smoothing   = 0.3;  // ← ADJUST FOR SMOOTHNESS
     
     
+    /***************************************************************************
+     * CUSTOM RESPONSE CURVE (optional)
+     * 
+     * mouse_curve_type:
+     *   - MOUSE_CURVE_POWER     = use mouse_curve above (default)
+     *   - MOUSE_CURVE_PIECEWISE = straight lines through the points below
+     *   - MOUSE_CURVE_BEZIER    = smooth curve bent towards the points below
+     * 
+     * Points are {stick deflection, mouse speed}, both 0.0 to 1.0, in order
+     * of increasing deflection (up to 8). The curve always starts at {0, 0}
+     * and ends at {1, 1}. With no points the power curve is used.
+     * 
+     * Example - slow and precise up to 60%, then ramp up quickly:
+     *   mapping.sticks.mouse_curve_type = MOUSE_CURVE_PIECEWISE;
+     *   mapping.sticks.mouse_curve_point_count = 1;
+     *   mapping.sticks.mouse_curve_points[0][0] = 0.6;
+     *   mapping.sticks.mouse_curve_points[0][1] = 0.2;
+     **************************************************************************/
+    
+    mapping.sticks.mouse_curve_type        = MOUSE_CURVE_POWER;
+    mapping.sticks.mouse_curve_point_count = 0;
+    
+    
     /***************************************************************************
      * DEADZONE (for both sticks)
      * 
@@ -217,6 +402,58 @@ static inline ControllerMapping get_default_mapping(void) {
     mapping.sticks.deadzone = 8000;  // ← ADJUST IF STICK DRIFTS
     
     
+    /***************************************************************************
+     * ANALOG KEYS (for sticks in WASD or ARROWS mode)
+     * 
+     * pwm_hz: Keys only know on and off, so by default any tilt past 30%
+     * holds the key. With pwm_hz set, each key is instead pressed for a
+     * share of every cycle that grows with the tilt (15% tilt = never,
+     * 90% or more = always), so half a tilt moves about half as far.
+     *   - 0  = off (default)
+     *   - 20 = good for most games (one cycle every 50 ms)
+     *   - 50 = smoother, but very short presses may be missed by some games
+     * 
+     * walk_key / run_key: Hold a modifier by how far the stick is tilted,
+     * e.g. walk (Left Control) while barely tilted, sprint (Left Shift)
+     * when pushed all the way. Set walk_below / run_above to 0 to turn
+     * them off.
+     **************************************************************************/
+    
+    mapping.sticks.pwm_hz     = 0;      // ← 20 for analog-like movement
+    mapping.sticks.walk_key   = 0x3B;   // Left Control
+    mapping.sticks.walk_below = 0.0;    // e.g. 0.5 = walk below half tilt
+    mapping.sticks.run_key    = 0x38;   // Left Shift
+    mapping.sticks.run_above  = 0.0;    // e.g. 0.95 = sprint at full tilt
+    
+    
+    /***************************************************************************
+     * KEY DIRECTIONS (for sticks in WASD or ARROWS mode)
+     * 
+     * key_directions:
+     *   - KEY_DIRECTIONS_AXES = up/down and left/right each past key_press
+     *                           on their own axis (default)
+     *   - KEY_DIRECTIONS_4    = only the closest of up, down, left, right
+     *   - KEY_DIRECTIONS_8    = the closest of those or of the 4 diagonals
+     * 
+     * key_press / key_release: A key goes down once the stick is tilted
+     * past key_press and only comes up again below key_release, so a stick
+     * resting near the threshold doesn't make the key chatter.
+     * 
+     * sector_overlap: With 4 or 8 directions, a held direction stays held
+     * this many degrees into the next one before switching, e.g. 10.
+     * 
+     * snapback_ms: A stick let go springs back past the center and briefly
+     * points the other way. The opposite key is ignored for this long after
+     * a release, e.g. 40 (a deliberate reversal is delayed by as much).
+     **************************************************************************/
+    
+    mapping.sticks.key_directions = KEY_DIRECTIONS_AXES;
+    mapping.sticks.key_press      = 0.3;    // ← ADJUST FOR SENSITIVITY
+    mapping.sticks.key_release    = 0.3;    // e.g. 0.2 to stop chatter
+    mapping.sticks.sector_overlap = 0.0;    // e.g. 10 (degrees)
+    mapping.sticks.snapback_ms    = 0;      // e.g. 40
+    
+    
     /***************************************************************************
      * TRIGGER CONFIGURATION
      * 
@@ -249,6 +486,62 @@ static inline ControllerMapping get_default_mapping(void) {
     mapping.triggers.threshold = 127;  // ← ADJUST SENSITIVITY
     
     
+    /***************************************************************************
+     * ACTIONS (optional)
+     * 
+     * Combos, tap/hold, turbo and macros. None by default: every button is
+     * its plain key from above. Up to 16 actions.
+     * 
+     * chord_window_ms: A button that is part of a chord waits this long for
+     * the rest of the chord before acting alone (only those buttons wait).
+     *   - 30 = snappy, chords must be pressed quite exactly together
+     *   - 50 = default
+     * 
+     * Example - LB+A types "hi", RB fires E 15 times per second, and X is
+     * R when tapped but F when held:
+     *   ActionMapping *action = &mapping.actions.list[mapping.actions.count++];
+     *   action->buttons = XBOX_BTN_LB | XBOX_BTN_A;
+     *   action->type = ACTION_MACRO;
+     *   action->step_count = 2;
+     *   action->steps[0] = (MacroStep){0x04, 30};   // H, held 30 ms
+     *   action->steps[1] = (MacroStep){0x22, 30};   // I
+     * 
+     *   action = &mapping.actions.list[mapping.actions.count++];
+     *   action->buttons = XBOX_BTN_RB;
+     *   action->type = ACTION_TURBO;
+     *   action->key = 0x0E;
+     *   action->rate_hz = 15;
+     * 
+     *   action = &mapping.actions.list[mapping.actions.count++];
+     *   action->buttons = XBOX_BTN_X;
+     *   action->type = ACTION_TAP_HOLD;
+     *   action->key = 0x0F;
+     *   action->hold_key = 0x03;
+     *   action->hold_ms = 200;
+     **************************************************************************/
+    
+    mapping.actions.chord_window_ms = 50;
+    mapping.actions.count = 0;
+    
+    
+    /***************************************************************************
+     * LAYERS (optional)
+     * 
+     * Hold a button to change settings while it's held. None by default.
+     * Up to 4 layers, each changing up to 24 settings.
+     * 
+     * Example - hold LB to aim: slower mouse, A is Return and B is V:
+     *   LayerMapping *layer = &mapping.layers.list[mapping.layers.count++];
+     *   strcpy(layer->name, "aim");
+     *   layer->buttons = XBOX_BTN_LB;
+     *   LAYER_SET(layer, sticks.mouse_sensitivity, 0.6f);
+     *   LAYER_SET(layer, buttons.key_a, 0x24);
+     *   LAYER_SET(layer, buttons.key_b, 0x09);
+     **************************************************************************/
+    
+    mapping.layers.count = 0;
+    
+    
     /***************************************************************************
      * ADVANCED SETTINGS
      * 
@@ -259,10 +552,20 @@ static inline ControllerMapping get_default_mapping(void) {
      * streaming_mode: Optimize for game streaming (Moonlight/Parsec)?
      *   - false = Local gaming (default)
      *   - true  = Streaming mode (use relative mouse movement)
+     * 
+     * usb_transfers: How many USB reads are kept queued at once (1-16)
+     *   - 1 = one read at a time (packets can wait between reads)
+     *   - 4 = default (controller always has somewhere to send)
+     * 
+     * output_rate_hz: How often a held stick moves the mouse (per second)
+     *   - 125 / 250 / 500 / 1000 (default 250)
+     *   - Cursor speed is the same at every rate, higher is just smoother
      **************************************************************************/
     
     mapping.console_output_enabled = true;   // ← Set to false to hide debug output
     mapping.streaming_mode         = false;  // ← Set to true for Moonlight/Parsec
+    mapping.usb_transfers          = 4;      // ← Reads in flight
+    mapping.output_rate_hz         = 250;    // ← Mouse update rate
     
     
     return mapping;
@@ -0,0 +1,212 @@
+// latency.h
+// Input latency instrumentation: fixed-memory log-linear histograms
+// Every packet is timestamped at each pipeline stage (USB completion,
+// decode, hand-off to the injector thread, mapping, sink post). Recording
+// is a few integer operations into preallocated buckets, so it can stay on
+// permanently.
+
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "timing.h"
+#include "output_sink.h"
+
+// Values below 16 ns get their own bucket; above that each power of two is
+// split into 16 linear sub-buckets (~6% worst-case error)
+#define LATENCY_SUB_BITS     4
+#define LATENCY_SUB_COUNT    (1 << LATENCY_SUB_BITS)
+#define LATENCY_BUCKETS      (64 * LATENCY_SUB_COUNT)
+
+typedef struct {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t min;
+    uint64_t max;
+    uint32_t buckets[LATENCY_BUCKETS];
+} LatencyHistogram;
+
+static inline unsigned latency_bucket_index(uint64_t value) {
+    if (value < LATENCY_SUB_COUNT) {
+        return (unsigned)value;
+    }
+    unsigned msb = 63 - __builtin_clzll(value);
+    unsigned shift = msb - LATENCY_SUB_BITS;
+    return (shift + 1) * LATENCY_SUB_COUNT +
+           (unsigned)((value >> shift) & (LATENCY_SUB_COUNT - 1));
+}
+
+// Largest value that lands in bucket index
+static inline uint64_t latency_bucket_upper(unsigned index) {
+    if (index < LATENCY_SUB_COUNT) {
+        return index;
+    }
+    unsigned shift = index / LATENCY_SUB_COUNT - 1;
+    uint64_t lower = (uint64_t)(LATENCY_SUB_COUNT + index % LATENCY_SUB_COUNT) << shift;
+    return lower + ((uint64_t)1 << shift) - 1;
+}
+
+static inline void latency_record(LatencyHistogram *h, uint64_t value_ns) {
+    h->buckets[latency_bucket_index(value_ns)]++;
+    if (h->count == 0 || value_ns < h->min) h->min = value_ns;
+    if (value_ns > h->max) h->max = value_ns;
+    h->count++;
+    h->sum += value_ns;
+}
+
+// Value at quantile q (0.0-1.0), accurate to the bucket width
+static inline uint64_t latency_percentile(const LatencyHistogram *h, double q) {
+    if (h->count == 0) {
+        return 0;
+    }
+    uint64_t rank = (uint64_t)(q * (double)h->count + 0.999999);
+    if (rank < 1) rank = 1;
+
+    uint64_t seen = 0;
+    for (unsigned i = 0; i < LATENCY_BUCKETS; i++) {
+        seen += h->buckets[i];
+        if (seen >= rank) {
+            uint64_t upper = latency_bucket_upper(i);
+            return upper < h->max ? upper : h->max;
+        }
+    }
+    return h->max;
+}
+
+// ============================================================================
+// Pipeline Stages
+// ============================================================================
+
+typedef enum {
+    LATENCY_QUEUE,        // USB completion -> packet handler starts
+    LATENCY_DECODE,       // Header/length validation and dispatch
+    LATENCY_HANDOFF,      // Reader thread -> injector thread
+    LATENCY_MAP,          // Translation to key/mouse events (excluding sink time)
+    LATENCY_POST,         // Time spent inside the output sink
+    LATENCY_TOTAL,        // USB completion -> last event posted
+    LATENCY_INTERARRIVAL, // Time between consecutive input packets
+    LATENCY_JITTER,       // Change in inter-arrival time from one packet to the next
+    LATENCY_STAGE_COUNT
+} LatencyStage;
+
+typedef struct {
+    LatencyHistogram stages[LATENCY_STAGE_COUNT];
+    uint64_t last_arrival_ns;
+    uint64_t last_interval_ns;
+} LatencyStats;
+
+// Record one input packet. Timestamps are monotonic_ns() values; picked_ns
+// is when the injector took it over (decoded_ns when there is no hand-off),
+// post_ns the total time the sink spent on this packet's events.
+static inline void latency_record_packet(LatencyStats *stats, uint64_t complete_ns,
+                                         uint64_t start_ns, uint64_t decoded_ns,
+                                         uint64_t picked_ns, uint64_t done_ns,
+                                         uint64_t post_ns) {
+    uint64_t mapped = done_ns - picked_ns;
+    latency_record(&stats->stages[LATENCY_QUEUE], start_ns - complete_ns);
+    latency_record(&stats->stages[LATENCY_DECODE], decoded_ns - start_ns);
+    latency_record(&stats->stages[LATENCY_HANDOFF], picked_ns - decoded_ns);
+    latency_record(&stats->stages[LATENCY_MAP], mapped > post_ns ? mapped - post_ns : 0);
+    latency_record(&stats->stages[LATENCY_POST], post_ns);
+    latency_record(&stats->stages[LATENCY_TOTAL], done_ns - complete_ns);
+
+    if (stats->last_arrival_ns != 0 && complete_ns >= stats->last_arrival_ns) {
+        uint64_t interval = complete_ns - stats->last_arrival_ns;
+        latency_record(&stats->stages[LATENCY_INTERARRIVAL], interval);
+        if (stats->last_interval_ns != 0) {
+            uint64_t jitter = interval > stats->last_interval_ns ?
+                              interval - stats->last_interval_ns :
+                              stats->last_interval_ns - interval;
+            latency_record(&stats->stages[LATENCY_JITTER], jitter);
+        }
+        stats->last_interval_ns = interval;
+    }
+    stats->last_arrival_ns = complete_ns;
+}
+
+// Print one row per stage (microseconds). label, if given, names the
+// source (e.g. which controller) in the title.
+static inline void latency_dump(const LatencyStats *stats, const char *label, FILE *out) {
+    static const char *stage_names[LATENCY_STAGE_COUNT] = {
+        "queue", "decode", "handoff", "map", "post", "total", "interarrival", "jitter"
+    };
+
+    if (label) {
+        fprintf(out, "\n=== Input Latency, %s (us) ===\n", label);
+    } else {
+        fprintf(out, "\n=== Input Latency (us) ===\n");
+    }
+    fprintf(out, "%-13s %9s %9s %9s %9s %9s %9s\n",
+            "stage", "count", "mean", "p50", "p99", "p99.9", "max");
+    for (int i = 0; i < LATENCY_STAGE_COUNT; i++) {
+        const LatencyHistogram *h = &stats->stages[i];
+        fprintf(out, "%-13s %9llu %9.1f %9.1f %9.1f %9.1f %9.1f\n",
+                stage_names[i], (unsigned long long)h->count,
+                h->count ? (double)h->sum / h->count / 1000.0 : 0.0,
+                latency_percentile(h, 0.50) / 1000.0,
+                latency_percentile(h, 0.99) / 1000.0,
+                latency_percentile(h, 0.999) / 1000.0,
+                h->max / 1000.0);
+    }
+    fflush(out);
+}
+
+// ============================================================================
+// Timed Sink - measures time spent in the sink it wraps
+// ============================================================================
+
+typedef struct {
+    OutputSink base;
+    OutputSink *target;
+    uint64_t elapsed_ns;    // Accumulated; the caller resets it per packet
+} TimedSink;
+
+static inline void timed_sink_key(OutputSink *sink, uint16_t keycode, bool pressed) {
+    TimedSink *timed = (TimedSink *)sink;
+    uint64_t start = monotonic_ns();
+    sink_key(timed->target, keycode, pressed);
+    timed->elapsed_ns += monotonic_ns() - start;
+}
+
+static inline void timed_sink_mouse_button(OutputSink *sink, MouseButton button, bool pressed) {
+    TimedSink *timed = (TimedSink *)sink;
+    uint64_t start = monotonic_ns();
+    sink_mouse_button(timed->target, button, pressed);
+    timed->elapsed_ns += monotonic_ns() - start;
+}
+
+static inline void timed_sink_mouse_move(OutputSink *sink, float dx, float dy) {
+    TimedSink *timed = (TimedSink *)sink;
+    uint64_t start = monotonic_ns();
+    sink_mouse_move(timed->target, dx, dy);
+    timed->elapsed_ns += monotonic_ns() - start;
+}
+
+static inline void timed_sink_gamepad(OutputSink *sink, uint8_t pad, const GamepadReport *report) {
+    TimedSink *timed = (TimedSink *)sink;
+    uint64_t start = monotonic_ns();
+    sink_gamepad(timed->target, pad, report);
+    timed->elapsed_ns += monotonic_ns() - start;
+}
+
+static inline void timed_sink_flush(OutputSink *sink) {
+    TimedSink *timed = (TimedSink *)sink;
+    uint64_t start = monotonic_ns();
+    sink_flush(timed->target);
+    timed->elapsed_ns += monotonic_ns() - start;
+}
+
+static inline void timed_sink_init(TimedSink *timed, OutputSink *target) {
+    timed->base.name = target->name;
+    timed->base.key = timed_sink_key;
+    timed->base.mouse_button = timed_sink_mouse_button;
+    timed->base.mouse_move = timed_sink_mouse_move;
+    timed->base.gamepad = timed_sink_gamepad;
+    timed->base.flush = timed_sink_flush;
+    timed->target = target;
+    timed->elapsed_ns = 0;
+}
+
+#endif // LATENCY_H
@@ -0,0 +1,929 @@
+// mapper.h
+// Controller-to-keyboard/mouse translation pipeline
+// Turns decoded GIP input into key, mouse button and mouse movement events
+// on an OutputSink. Has no OS dependencies, so it builds and runs anywhere.
+
+#ifndef MAPPER_H
+#define MAPPER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include "gip.h"
+#include "keymapping.h"
+#include "response_curve.h"
+#include "stick_kernel.h"
+#include "output_sink.h"
+#include "actions.h"
+#include "timing.h"
+
+// State tracking for keys (prevent redundant events)
+typedef struct {
+    bool keys[256];           // Track which keys are currently pressed
+    bool mouse_left;          // Left mouse button state
+    bool mouse_right;         // Right mouse button state
+    bool mouse_middle;        // Middle mouse button state
+    
+    // Previous controller state for change detection
+    uint16_t prev_buttons;
+    uint8_t prev_left_trigger;
+    uint8_t prev_right_trigger;
+    int16_t prev_left_stick_x;
+    int16_t prev_left_stick_y;
+    int16_t prev_right_stick_x;
+    int16_t prev_right_stick_y;
+    
+    // Current stick positions after the deadzone (for continuous movement),
+    // as reported: {left x, left y, right x, right y}
+    int16_t current_sticks[STICK_LANES];
+    
+    // Smoothed stick positions (for mouse mode), in cursor space:
+    // {left x, left y, right x, right y}
+    float smoothed[STICK_LANES];
+    
+    // Mouse delta accumulation
+    float mouse_dx;
+    float mouse_dy;
+    
+    // Input payload of the last packet (everything after the GIP header)
+    uint8_t prev_payload[sizeof(GipInputPacket) - sizeof(GipHeader)];
+    bool have_prev_payload;
+} InputState;
+
+// Mouse speeds were tuned when movement was generated ~100 times per second.
+// Deltas are scaled by elapsed time relative to this rate, so the cursor
+// speed is the same at every output rate.
+#define MOUSE_REFERENCE_RATE_HZ 100.0f
+
+// Key-mode sticks with pwm_hz: an axis's key is held for a share of every
+// cycle that rises linearly between these deflections
+#define PWM_DEFLECTION_START    0.15f
+#define PWM_DEFLECTION_FULL     0.9f
+
+// Walk/run modifiers let go only this far past their threshold, so a
+// stick resting on it doesn't flicker the key
+#define BAND_HYSTERESIS         0.03f
+
+// Directions of a key-mode stick, as bits
+#define DIR_UP      0x1
+#define DIR_DOWN    0x2
+#define DIR_LEFT    0x4
+#define DIR_RIGHT   0x8
+
+// Longest tick the output clock will account for (see output_tick)
+#define MOUSE_MAX_TICK_NS       (50 * NS_PER_MS)
+#define MOUSE_MAX_TICK_SCALE    (MOUSE_MAX_TICK_NS * MOUSE_REFERENCE_RATE_HZ / NS_PER_SEC)
+
+// A ControllerMapping prepared for the pipeline: everything that can be
+// derived from the settings is computed once here instead of per packet
+typedef struct {
+    ControllerMapping config;
+    int32_t deadzone_sq;        // Deadzone radius squared
+    Lut mouse_curve;            // |deflection| -> speed
+    Lut smoothing_alpha;        // Tick length (0..MOUSE_MAX_TICK_SCALE) -> smoothing weight
+    float mouse_gain[STICK_LANES];  // Per-lane sensitivity, 0 for sticks not in mouse mode
+    bool mouse_sticks;          // At least one stick is in mouse mode
+    uint64_t pwm_period_ns;     // Key-mode stick cycle, 0 = plain on/off keys
+    float key_release;          // key_press at most
+    uint8_t key_sectors;        // 4 or 8 directions; 0 = each axis on its own
+    float sector_width;         // Radians
+    float sector_keep;          // How far a held direction reaches, radians
+    uint64_t snapback_ns;
+    bool key_filtered;          // Any of key_release, sector_overlap, snapback_ms
+    uint16_t button_keys[16];   // Keycode for each bit of GipInputPacket.buttons
+    uint16_t button_mask;       // Bits that have a key bound
+    CompiledActions actions;    // Buttons in actions.engine_mask go to the action engine
+} CompiledMapping;
+
+static inline void compile_mapping(CompiledMapping *compiled, const ControllerMapping *config) {
+    compiled->config = *config;
+    compiled->deadzone_sq = (int32_t)config->sticks.deadzone * config->sticks.deadzone;
+    lut_build_mouse_curve(&compiled->mouse_curve, &config->sticks);
+    lut_build_smoothing(&compiled->smoothing_alpha, config->sticks.mouse_smoothing,
+                        MOUSE_MAX_TICK_SCALE);
+    
+    float gain = config->sticks.mouse_sensitivity * 15.0f;
+    bool left = config->sticks.left_stick_mode == STICK_MODE_MOUSE;
+    bool right = config->sticks.right_stick_mode == STICK_MODE_MOUSE;
+    compiled->mouse_gain[0] = compiled->mouse_gain[1] = left ? gain : 0.0f;
+    compiled->mouse_gain[2] = compiled->mouse_gain[3] = right ? gain : 0.0f;
+    compiled->mouse_sticks = left || right;
+    compiled->pwm_period_ns = config->sticks.pwm_hz ? NS_PER_SEC / config->sticks.pwm_hz : 0;
+    
+    const StickMapping *s = &config->sticks;
+    compiled->key_release = fminf(s->key_release, s->key_press);
+    compiled->key_sectors = s->key_directions == KEY_DIRECTIONS_8 ? 8 :
+                            s->key_directions == KEY_DIRECTIONS_4 ? 4 : 0;
+    compiled->sector_width = compiled->key_sectors ? 2.0f * (float)M_PI / compiled->key_sectors : 0.0f;
+    compiled->sector_keep = compiled->sector_width / 2.0f + s->sector_overlap * (float)M_PI / 180.0f;
+    compiled->snapback_ns = (uint64_t)s->snapback_ms * NS_PER_MS;
+    compiled->key_filtered = compiled->key_release < s->key_press ||
+                             (compiled->key_sectors && s->sector_overlap > 0.0f) ||
+                             compiled->snapback_ns > 0;
+    
+    const ButtonMapping *b = &config->buttons;
+    const struct {
+        uint16_t mask;
+        uint16_t keycode;
+    } button_map[] = {
+        {XBOX_BTN_A, b->key_a},
+        {XBOX_BTN_B, b->key_b},
+        {XBOX_BTN_X, b->key_x},
+        {XBOX_BTN_Y, b->key_y},
+        {XBOX_BTN_LB, b->key_lb},
+        {XBOX_BTN_RB, b->key_rb},
+        {XBOX_BTN_LS, b->key_ls},
+        {XBOX_BTN_RS, b->key_rs},
+        {XBOX_BTN_VIEW, b->key_view},
+        {XBOX_BTN_MENU, b->key_menu},
+        {XBOX_BTN_DPAD_UP, b->key_dpad_up},
+        {XBOX_BTN_DPAD_DOWN, b->key_dpad_down},
+        {XBOX_BTN_DPAD_LEFT, b->key_dpad_left},
+        {XBOX_BTN_DPAD_RIGHT, b->key_dpad_right}
+    };
+    
+    memset(compiled->button_keys, 0, sizeof(compiled->button_keys));
+    compiled->button_mask = 0;
+    for (size_t i = 0; i < sizeof(button_map) / sizeof(button_map[0]); i++) {
+        compiled->button_keys[__builtin_ctz(button_map[i].mask)] = button_map[i].keycode;
+        compiled->button_mask |= button_map[i].mask;
+    }
+    compile_actions(&compiled->actions, &config->actions, compiled->button_keys,
+                    compiled->button_mask);
+}
+
+static inline void layer_apply(ControllerMapping *config, const LayerMapping *layer) {
+    for (int i = 0; i < layer->override_count; i++) {
+        const LayerOverride *o = &layer->overrides[i];
+        memcpy((uint8_t *)config + o->offset, o->value, o->size);
+    }
+}
+
+// A ControllerMapping with its layers resolved ahead of time: one compiled
+// table for every combination of active layers, so switching layers on the
+// input path is only a pointer change
+typedef struct {
+    CompiledMapping tables[1 << LAYER_MAX];     // Indexed by the active layer mask
+    uint16_t layer_buttons[LAYER_MAX];
+    uint16_t layer_mask;        // Every button that switches a layer
+    uint8_t layer_count;
+} CompiledProfile;
+
+static inline void compile_profile(CompiledProfile *profile, const ControllerMapping *config) {
+    profile->layer_count = config->layers.count;
+    profile->layer_mask = 0;
+    for (int i = 0; i < config->layers.count; i++) {
+        profile->layer_buttons[i] = config->layers.list[i].buttons;
+        profile->layer_mask |= config->layers.list[i].buttons;
+    }
+    
+    // Later layers are applied last, so they win where two active layers
+    // change the same setting
+    for (unsigned active = 0; active < (1u << config->layers.count); active++) {
+        ControllerMapping resolved = *config;
+        for (int i = 0; i < config->layers.count; i++) {
+            if (active & (1u << i)) {
+                layer_apply(&resolved, &config->layers.list[i]);
+            }
+        }
+        compile_mapping(&profile->tables[active], &resolved);
+    }
+}
+
+// Layers whose buttons are all held
+static inline unsigned profile_active_layers(const CompiledProfile *profile, uint16_t buttons) {
+    unsigned active = 0;
+    for (int i = 0; i < profile->layer_count; i++) {
+        if ((buttons & profile->layer_buttons[i]) == profile->layer_buttons[i]) {
+            active |= 1u << i;
+        }
+    }
+    return active;
+}
+
+// One axis of a key-mode stick with pwm_hz: its key is pressed at the
+// start of every cycle and released after duty of it. Runs on the action
+// engine's timer wheel, so edges land on the same clock as other timed
+// actions and the injector sleeps until the next one.
+typedef struct {
+    TimerNode timer;
+    bool active;                // Cycling (duty > 0)
+    bool pressed;
+    bool release_next;          // The timer is the release, not the next cycle
+    uint16_t key;               // Key of the direction the axis points
+    float duty;                 // 0.0-1.0, taken up at the start of each cycle
+    uint64_t cycle_start_ns;
+} PwmAxis;
+
+// A stick in WASD or ARROWS mode without pwm_hz. Presses of the opposite
+// direction right after a release are held back by a timer on the action
+// engine's wheel, which looks at the stick again once the window is over.
+typedef struct {
+    TimerNode timer;
+    uint16_t keys[4];           // Up, down, left, right, as last processed
+    uint8_t plain;              // Directions the bare key_press test would hold
+    uint8_t deferred;           // Presses being held back
+    uint64_t snapback_until_ns[4];  // Per direction bit, from its last release
+} KeyStick;
+
+// Redundant key events the key-mode sticks didn't send, for the session
+// summary. plain_events counts what the bare key_press test (no
+// key_release, overlap or snapback) would have sent.
+typedef struct {
+    uint64_t key_events;
+    uint64_t plain_events;
+    uint64_t snapbacks;         // Opposite-direction presses ignored
+} StickKeyStats;
+
+// One translation pipeline: a compiled profile, the state it tracks, and
+// where its events go
+typedef struct {
+    const CompiledProfile *profile;
+    const CompiledMapping *map;         // &profile->tables[layers]
+    const ControllerMapping *config;    // &map->config
+    unsigned layers;                    // Active layers
+    OutputSink *sink;
+    InputState state;
+    ActionEngine actions;       // Chords, tap/hold, turbo, macros
+    PwmAxis pwm[STICK_LANES];   // As current_sticks: {left x, left y, right x, right y}
+    KeyStick key_sticks[2];     // Left, right
+    StickKeyStats stick_stats;  // Kept across resets and profile changes
+} Mapper;
+
+static inline void pwm_axis_fired(TimerNode *node);
+static inline void key_stick_fired(TimerNode *node);
+
+static inline void mapper_use_layers(Mapper *m, unsigned layers) {
+    m->layers = layers;
+    m->map = &m->profile->tables[layers];
+    m->config = &m->map->config;
+    m->actions.map = &m->map->actions;
+}
+
+static inline void mapper_init(Mapper *m, const CompiledProfile *profile, OutputSink *sink) {
+    memset(m, 0, sizeof(*m));
+    m->profile = profile;
+    m->sink = sink;
+    action_engine_init(&m->actions, &profile->tables[0].actions, sink, m->state.keys);
+    for (int i = 0; i < STICK_LANES; i++) {
+        timer_node_init(&m->pwm[i].timer, pwm_axis_fired, m, i);
+    }
+    for (int i = 0; i < 2; i++) {
+        timer_node_init(&m->key_sticks[i].timer, key_stick_fired, m, i);
+    }
+    mapper_use_layers(m, 0);
+}
+
+// ============================================================================
+// Input Processing Functions
+// ============================================================================
+
+// Compares squared magnitudes, so the common cases (inside the deadzone or
+// inside the unit circle) need no square root. Faster than
+// stick_kernel_deadzone() for just two sticks (see bench.c), so this is the
+// one process_sticks uses.
+static inline void apply_deadzone(int16_t *x, int16_t *y, int32_t deadzone_sq) {
+    int64_t magnitude_sq = (int64_t)(*x) * (*x) + (int64_t)(*y) * (*y);
+    
+    if (magnitude_sq < deadzone_sq) {
+        *x = 0;
+        *y = 0;
+    } else if (magnitude_sq > (int64_t)32767 * 32767) {
+        // Normalize if outside unit circle (only reachable in the corners)
+        float scale = 32767.0f / sqrtf((float)magnitude_sq);
+        *x = (int16_t)(*x * scale);
+        *y = (int16_t)(*y * scale);
+    }
+}
+
+// Only the bits that changed since the last packet are visited. Buttons
+// with an action go through the action engine; the rest are plain keys.
+static inline void process_buttons(Mapper *m, uint16_t buttons) {
+    unsigned changed = (unsigned)(buttons ^ m->state.prev_buttons);
+    unsigned engine = changed & m->map->actions.engine_mask;
+    changed &= m->map->button_mask & ~m->map->actions.engine_mask;
+    
+    while (engine) {
+        int bit = __builtin_ctz(engine);
+        engine &= engine - 1;
+        action_button(&m->actions, bit, (buttons >> bit) & 1);
+    }
+    
+    while (changed) {
+        int bit = __builtin_ctz(changed);
+        changed &= changed - 1;
+        
+        bool is_pressed = (buttons >> bit) & 1;
+        uint16_t keycode = m->map->button_keys[bit];
+        sink_key(m->sink, keycode, is_pressed);
+        m->state.keys[keycode] = is_pressed;
+    }
+    
+    m->state.prev_buttons = buttons;
+}
+
+static inline void process_triggers(Mapper *m, uint8_t left_trigger, uint8_t right_trigger) {
+    // Right trigger (swapped - GIP packet has them reversed)
+    bool right_pressed = left_trigger > m->config->triggers.threshold;
+    bool right_was_pressed = m->state.prev_right_trigger > m->config->triggers.threshold;
+    
+    if (right_pressed != right_was_pressed) {
+        if (m->config->triggers.right_trigger_mode == TRIGGER_MODE_MOUSE) {
+            sink_mouse_button(m->sink, MOUSE_BUTTON_RIGHT, right_pressed);
+            m->state.mouse_right = right_pressed;
+        } else if (m->config->triggers.right_trigger_mode == TRIGGER_MODE_KEY) {
+            sink_key(m->sink, m->config->triggers.right_trigger_key, right_pressed);
+            m->state.keys[m->config->triggers.right_trigger_key] = right_pressed;
+        }
+    }
+    
+    // Left trigger (swapped - GIP packet has them reversed)
+    bool left_pressed = right_trigger > m->config->triggers.threshold;
+    bool left_was_pressed = m->state.prev_left_trigger > m->config->triggers.threshold;
+    
+    if (left_pressed != left_was_pressed) {
+        if (m->config->triggers.left_trigger_mode == TRIGGER_MODE_MOUSE) {
+            sink_mouse_button(m->sink, MOUSE_BUTTON_LEFT, left_pressed);
+            m->state.mouse_left = left_pressed;
+        } else if (m->config->triggers.left_trigger_mode == TRIGGER_MODE_KEY) {
+            sink_key(m->sink, m->config->triggers.left_trigger_key, left_pressed);
+            m->state.keys[m->config->triggers.left_trigger_key] = left_pressed;
+        }
+    }
+    
+    m->state.prev_left_trigger = right_trigger;  // Swapped
+    m->state.prev_right_trigger = left_trigger;  // Swapped
+}
+
+// Directions that x (right) and y (up), -1.0 to 1.0, point to, each axis
+// on its own. held keeps its keys down to release instead of press.
+static inline uint8_t key_stick_axes(float x, float y, uint8_t held, float press, float release) {
+    uint8_t dirs = 0;
+    if (y > (held & DIR_UP ? release : press)) dirs |= DIR_UP;
+    if (y < -(held & DIR_DOWN ? release : press)) dirs |= DIR_DOWN;
+    if (x < -(held & DIR_LEFT ? release : press)) dirs |= DIR_LEFT;
+    if (x > (held & DIR_RIGHT ? release : press)) dirs |= DIR_RIGHT;
+    return dirs;
+}
+
+// The same by angle, one of key_sectors directions at a time. With
+// hysteresis held also keeps its direction across sector_overlap.
+static inline uint8_t key_stick_sectors(const CompiledMapping *map, float x, float y,
+                                        uint8_t held, bool hysteresis) {
+    static const uint8_t sector_dirs[8] = {
+        DIR_RIGHT, DIR_UP | DIR_RIGHT, DIR_UP, DIR_UP | DIR_LEFT,
+        DIR_LEFT, DIR_DOWN | DIR_LEFT, DIR_DOWN, DIR_DOWN | DIR_RIGHT
+    };
+    float threshold = held && hysteresis ? map->key_release : map->config.sticks.key_press;
+    if (x * x + y * y <= threshold * threshold) {
+        return 0;
+    }
+    
+    int sectors = map->key_sectors;
+    int step = 8 / sectors;
+    float angle = atan2f(y, x);
+    if (hysteresis && held) {
+        for (int i = 0; i < sectors; i++) {
+            if (sector_dirs[i * step] != held) {
+                continue;
+            }
+            float offset = remainderf(angle - i * map->sector_width, 2.0f * (float)M_PI);
+            if (fabsf(offset) <= map->sector_keep) {
+                return held;
+            }
+            break;
+        }
+    }
+    int sector = (int)floorf(angle / map->sector_width + 0.5f);
+    sector = (sector + sectors) % sectors;
+    return sector_dirs[sector * step];
+}
+
+// Without hysteresis: the bare key_press test, for the counters
+static inline uint8_t key_stick_classify(const CompiledMapping *map, float x, float y,
+                                         uint8_t held, bool hysteresis) {
+    if (map->key_sectors) {
+        return key_stick_sectors(map, x, y, held, hysteresis);
+    }
+    float press = map->config.sticks.key_press;
+    return key_stick_axes(x, y, held, press, hysteresis ? map->key_release : press);
+}
+
+// Move the stick's keys to where x and y point, minus snapback presses
+static inline void key_stick_update(Mapper *m, KeyStick *k, float x, float y) {
+    uint8_t held = 0;
+    for (int i = 0; i < 4; i++) {
+        held |= (uint8_t)(m->state.keys[k->keys[i]] << i);
+    }
+    uint8_t want = key_stick_classify(m->map, x, y, held, true);
+    uint64_t now = m->actions.now_ns;
+    
+    if (want == held && !k->deferred) {
+        return;
+    }
+    
+    // A stick let go can spring past the center between two packets, so
+    // releases open their window before this update's presses are looked at
+    for (uint8_t releases = held & ~want; releases; releases &= releases - 1) {
+        k->snapback_until_ns[__builtin_ctz(releases)] = now + m->map->snapback_ns;
+    }
+    
+    uint8_t deferred = 0;
+    uint64_t until = UINT64_MAX;
+    for (uint8_t presses = want & ~held; presses; presses &= presses - 1) {
+        int i = __builtin_ctz(presses);
+        int opposite = i ^ 1;   // Up/down and left/right are bit pairs
+        if (now < k->snapback_until_ns[opposite]) {
+            deferred |= 1u << i;
+            until = until < k->snapback_until_ns[opposite] ? until : k->snapback_until_ns[opposite];
+        }
+    }
+    if (deferred) {
+        m->stick_stats.snapbacks += __builtin_popcount(deferred & ~k->deferred);
+        timer_wheel_schedule(&m->actions.wheel, &k->timer, until);
+    } else if (k->deferred) {
+        timer_wheel_cancel(&m->actions.wheel, &k->timer);
+    }
+    k->deferred = deferred;
+    want &= ~deferred;
+    
+    for (uint8_t changed = want ^ held; changed; changed &= changed - 1) {
+        int i = __builtin_ctz(changed);
+        bool pressed = (want >> i) & 1;
+        sink_key(m->sink, k->keys[i], pressed);
+        m->state.keys[k->keys[i]] = pressed;
+        m->stick_stats.key_events++;
+        m->stick_stats.plain_events += !m->map->key_filtered;
+    }
+}
+
+// stick: 0 left, 1 right
+static inline void process_stick_as_keys(Mapper *m, int stick, int16_t x, int16_t y,
+                                         uint16_t key_up, uint16_t key_down,
+                                         uint16_t key_left, uint16_t key_right) {
+    // Axes are swapped in the controller - swap them back
+    // Physical up/down is reported in X, physical left/right is reported in Y
+    int16_t temp = x;
+    x = y;
+    y = temp;
+    
+    // Normalize to -1.0 to 1.0
+    float norm_x = x / 32767.0f;
+    float norm_y = y / 32767.0f;
+    
+    KeyStick *k = &m->key_sticks[stick];
+    k->keys[0] = key_up;
+    k->keys[1] = key_down;
+    k->keys[2] = key_left;
+    k->keys[3] = key_right;
+    
+    // Unfiltered, the events sent are the plain ones (counted as they go)
+    if (m->map->key_filtered) {
+        uint8_t plain = key_stick_classify(m->map, norm_x, norm_y, k->plain, false);
+        for (uint8_t changed = plain ^ k->plain; changed; changed &= changed - 1) {
+            m->stick_stats.plain_events++;
+        }
+        k->plain = plain;
+    }
+    
+    key_stick_update(m, k, norm_x, norm_y);
+}
+
+// The snapback window is over: look at where the stick points now
+static inline void key_stick_fired(TimerNode *node) {
+    Mapper *m = (Mapper *)node->owner;
+    KeyStick *k = &m->key_sticks[node->arg];
+    const int16_t *lanes = &m->state.current_sticks[node->arg * 2];
+    key_stick_update(m, k, lanes[1] / 32767.0f, lanes[0] / 32767.0f);     // Swapped
+    sink_flush(m->sink);
+}
+
+static inline void key_stick_reset(Mapper *m) {
+    for (int i = 0; i < 2; i++) {
+        KeyStick *k = &m->key_sticks[i];
+        timer_wheel_cancel(&m->actions.wheel, &k->timer);
+        k->plain = 0;
+        k->deferred = 0;
+        memset(k->snapback_until_ns, 0, sizeof(k->snapback_until_ns));
+    }
+}
+
+static inline void pwm_axis_press(Mapper *m, PwmAxis *a, bool pressed) {
+    a->pressed = pressed;
+    sink_key(m->sink, a->key, pressed);
+    m->state.keys[a->key] = pressed;
+}
+
+// Bring the current cycle in line with duty as of now_ns: pressed from its
+// start for duty of it, then released until the next one. Very short
+// pulses are rounded up to what the timer wheel can resolve; a duty that
+// leaves no gap holds the key through the cycle.
+static inline void pwm_axis_update(Mapper *m, PwmAxis *a, uint64_t now_ns) {
+    uint64_t period = m->map->pwm_period_ns;
+    uint64_t on_ns = (uint64_t)(a->duty * (float)period);
+    if (on_ns < TIMER_WHEEL_RESOLUTION) {
+        on_ns = TIMER_WHEEL_RESOLUTION;
+    }
+    bool hold = on_ns + TIMER_WHEEL_RESOLUTION >= period;
+    uint64_t release_ns = a->cycle_start_ns + on_ns;
+    
+    if (hold || release_ns > now_ns) {
+        if (!a->pressed) {
+            pwm_axis_press(m, a, true);
+        }
+        a->release_next = !hold;
+        timer_wheel_schedule(&m->actions.wheel, &a->timer,
+                             hold ? a->cycle_start_ns + period : release_ns);
+    } else {
+        if (a->pressed) {
+            pwm_axis_press(m, a, false);
+        }
+        a->release_next = false;
+        timer_wheel_schedule(&m->actions.wheel, &a->timer, a->cycle_start_ns + period);
+    }
+}
+
+static inline void pwm_axis_fired(TimerNode *node) {
+    Mapper *m = (Mapper *)node->owner;
+    PwmAxis *a = &m->pwm[node->arg];
+    
+    if (!a->release_next) {
+        a->cycle_start_ns += m->map->pwm_period_ns;     // Next cycle, without drift
+    }
+    pwm_axis_update(m, a, node->deadline_ns);
+    sink_flush(m->sink);
+}
+
+static inline void pwm_axis_stop(Mapper *m, PwmAxis *a) {
+    timer_wheel_cancel(&m->actions.wheel, &a->timer);
+    if (a->pressed) {
+        pwm_axis_press(m, a, false);
+    }
+    a->active = false;
+}
+
+// value: -1.0 to 1.0 along the axis. Starting, stopping, changing direction
+// and changing duty all take effect at once; the cycle keeps its phase.
+static inline void pwm_axis_set(Mapper *m, PwmAxis *a, float value,
+                                uint16_t key_negative, uint16_t key_positive) {
+    float duty = (fabsf(value) - PWM_DEFLECTION_START) /
+                 (PWM_DEFLECTION_FULL - PWM_DEFLECTION_START);
+    duty = duty < 0.0f ? 0.0f : duty > 1.0f ? 1.0f : duty;
+    uint16_t key = value < 0.0f ? key_negative : key_positive;
+    
+    if (a->active && (duty == 0.0f || key != a->key)) {
+        pwm_axis_stop(m, a);
+    }
+    if (duty == 0.0f || (a->active && duty == a->duty)) {
+        return;
+    }
+    a->duty = duty;
+    if (!a->active) {
+        a->active = true;
+        a->key = key;
+        a->cycle_start_ns = m->actions.now_ns;
+    }
+    pwm_axis_update(m, a, m->actions.now_ns);
+}
+
+static inline void process_stick_as_pwm(Mapper *m, int lane, int16_t x, int16_t y,
+                                        uint16_t key_up, uint16_t key_down,
+                                        uint16_t key_left, uint16_t key_right) {
+    // Axes are swapped in the controller: physical up/down is reported in
+    // x (lane), physical left/right in y (lane + 1)
+    pwm_axis_set(m, &m->pwm[lane], x / 32767.0f, key_down, key_up);
+    pwm_axis_set(m, &m->pwm[lane + 1], y / 32767.0f, key_left, key_right);
+}
+
+static inline void stick_pwm_reset(Mapper *m) {
+    for (int i = 0; i < STICK_LANES; i++) {
+        timer_wheel_cancel(&m->actions.wheel, &m->pwm[i].timer);
+        m->pwm[i].active = false;
+        m->pwm[i].pressed = false;
+    }
+}
+
+static inline void process_key_stick(Mapper *m, int lane, int16_t x, int16_t y,
+                                     uint16_t key_up, uint16_t key_down,
+                                     uint16_t key_left, uint16_t key_right) {
+    if (m->map->pwm_period_ns) {
+        process_stick_as_pwm(m, lane, x, y, key_up, key_down, key_left, key_right);
+    } else {
+        process_stick_as_keys(m, lane / 2, x, y, key_up, key_down, key_left, key_right);
+    }
+}
+
+// Walk/run modifiers follow the most tilted key-mode stick
+static inline void process_stick_bands(Mapper *m, float magnitude) {
+    const StickMapping *sticks = &m->config->sticks;
+    if (sticks->walk_below > 0.0f) {
+        bool held = m->state.keys[sticks->walk_key];
+        float below = sticks->walk_below + (held ? BAND_HYSTERESIS : 0.0f);
+        bool walk = magnitude > 0.0f && magnitude < below;
+        if (walk != held) {
+            sink_key(m->sink, sticks->walk_key, walk);
+            m->state.keys[sticks->walk_key] = walk;
+        }
+    }
+    if (sticks->run_above > 0.0f) {
+        bool held = m->state.keys[sticks->run_key];
+        float above = sticks->run_above - (held ? BAND_HYSTERESIS : 0.0f);
+        bool run = magnitude > 0.0f && magnitude >= above;
+        if (run != held) {
+            sink_key(m->sink, sticks->run_key, run);
+            m->state.keys[sticks->run_key] = run;
+        }
+    }
+}
+
+// alpha: smoothing weight for this tick, scale: elapsed time in reference ticks
+// Scalar reference for stick_kernel_mouse(), kept for bench.c
+static inline void process_stick_as_mouse(Mapper *m, int16_t x, int16_t y,
+                                          float *smoothed_x, float *smoothed_y,
+                                          float alpha, float scale) {
+    // Axes are swapped in the controller - swap them back
+    // Physical up/down is reported in X, physical left/right is reported in Y
+    int16_t temp = x;
+    x = y;
+    y = temp;
+    
+    // Normalize to -1.0 to 1.0
+    float target_x = x / 32767.0f;
+    float target_y = -y / 32767.0f;  // Invert Y - pushing up should move cursor up
+    
+    // Exponential smoothing (higher smoothing = smoother but more lag)
+    // alpha determines how much of the new value vs old value to use
+    // smoothing = 0.0 means no smoothing (all new value)
+    // smoothing = 0.9 means heavy smoothing (mostly old value)
+    *smoothed_x = alpha * target_x + (1.0f - alpha) * (*smoothed_x);
+    *smoothed_y = alpha * target_y + (1.0f - alpha) * (*smoothed_y);
+    
+    // Use smoothed values for movement
+    float norm_x = *smoothed_x;
+    float norm_y = *smoothed_y;
+    
+    // Apply the response curve for better control
+    float curved_x = lut_lookup_signed(&m->map->mouse_curve, norm_x);
+    float curved_y = lut_lookup_signed(&m->map->mouse_curve, norm_y);
+    
+    // Scale by sensitivity and by the time this tick covers
+    float dx = curved_x * m->config->sticks.mouse_sensitivity * 15.0f * scale;
+    float dy = curved_y * m->config->sticks.mouse_sensitivity * 15.0f * scale;
+    
+    // Accumulate deltas (sent by output_tick)
+    m->state.mouse_dx += dx;
+    m->state.mouse_dy += dy;
+}
+
+static inline void process_sticks(Mapper *m, int16_t left_x, int16_t left_y,
+                                  int16_t right_x, int16_t right_y) {
+    // Apply deadzones
+    apply_deadzone(&left_x, &left_y, m->map->deadzone_sq);
+    apply_deadzone(&right_x, &right_y, m->map->deadzone_sq);
+    m->state.current_sticks[0] = left_x;
+    m->state.current_sticks[1] = left_y;
+    m->state.current_sticks[2] = right_x;
+    m->state.current_sticks[3] = right_y;
+    
+    // Key-mode sticks react to the packet immediately; mouse-mode sticks are
+    // sampled by the output tick
+    float magnitude = 0.0f;
+    bool key_sticks = false;
+    switch (m->config->sticks.left_stick_mode) {
+        case STICK_MODE_WASD:
+            process_key_stick(m, 0, left_x, left_y,
+                              m->config->sticks.left_up, m->config->sticks.left_down,
+                              m->config->sticks.left_left, m->config->sticks.left_right);
+            break;
+        case STICK_MODE_ARROWS:
+            process_key_stick(m, 0, left_x, left_y, 0x7E, 0x7D, 0x7B, 0x7C);
+            break;
+        case STICK_MODE_MOUSE:
+        case STICK_MODE_DISABLED:
+        default:
+            break;
+    }
+    if (m->config->sticks.left_stick_mode == STICK_MODE_WASD ||
+        m->config->sticks.left_stick_mode == STICK_MODE_ARROWS) {
+        key_sticks = true;
+        magnitude = hypotf(left_x, left_y) / 32767.0f;
+    }
+    
+    switch (m->config->sticks.right_stick_mode) {
+        case STICK_MODE_WASD:
+            process_key_stick(m, 2, right_x, right_y,
+                              m->config->sticks.left_up, m->config->sticks.left_down,
+                              m->config->sticks.left_left, m->config->sticks.left_right);
+            break;
+        case STICK_MODE_ARROWS:
+            process_key_stick(m, 2, right_x, right_y, 0x7E, 0x7D, 0x7B, 0x7C);
+            break;
+        case STICK_MODE_MOUSE:
+        case STICK_MODE_DISABLED:
+        default:
+            break;
+    }
+    if (m->config->sticks.right_stick_mode == STICK_MODE_WASD ||
+        m->config->sticks.right_stick_mode == STICK_MODE_ARROWS) {
+        key_sticks = true;
+        magnitude = fmaxf(magnitude, hypotf(right_x, right_y) / 32767.0f);
+    }
+    
+    if (key_sticks) {
+        process_stick_bands(m, magnitude);
+    }
+    
+    m->state.prev_left_stick_x = left_x;
+    m->state.prev_left_stick_y = left_y;
+    m->state.prev_right_stick_x = right_x;
+    m->state.prev_right_stick_y = right_y;
+}
+
+// Generate mouse movement from the currently held stick positions.
+// Called at a fixed rate by input_loop, independent of USB packet arrival.
+// dt_ns is the real time elapsed since the previous tick.
+static inline void output_tick(Mapper *m, uint64_t dt_ns) {
+    // Never extrapolate across a long stall (e.g. the process was suspended)
+    if (dt_ns > MOUSE_MAX_TICK_NS) {
+        dt_ns = MOUSE_MAX_TICK_NS;
+    }
+    float scale = (float)dt_ns / (float)NS_PER_SEC * MOUSE_REFERENCE_RATE_HZ;
+    
+    // Smoothing was tuned per reference tick; keep the same time constant
+    float alpha = lut_lookup(&m->map->smoothing_alpha, scale / MOUSE_MAX_TICK_SCALE);
+    
+    // Stick positions already have the deadzone applied by process_sticks;
+    // both mouse-mode sticks go through the kernel together
+    if (m->map->mouse_sticks) {
+        stick_kernel_mouse(m->state.current_sticks, m->state.smoothed, m->map->mouse_gain,
+                           &m->map->mouse_curve, alpha, scale,
+                           &m->state.mouse_dx, &m->state.mouse_dy);
+    }
+    
+    // Send whole pixels and carry the remainder, so slow movement at high
+    // output rates isn't lost to rounding
+    float send_dx = truncf(m->state.mouse_dx);
+    float send_dy = truncf(m->state.mouse_dy);
+    if (send_dx != 0.0f || send_dy != 0.0f) {
+        sink_mouse_move(m->sink, send_dx, send_dy);
+        m->state.mouse_dx -= send_dx;
+        m->state.mouse_dy -= send_dy;
+        sink_flush(m->sink);
+    }
+}
+
+// Move the pipeline's clock to now_ns (monotonic time live, capture time
+// when replaying) and run every timed action due by then. Call before each
+// packet and whenever mapper_next_deadline() comes up.
+static inline void mapper_advance(Mapper *m, uint64_t now_ns) {
+    action_engine_advance(&m->actions, now_ns);
+}
+
+// When mapper_advance next has work to do; UINT64_MAX if nothing is timed
+static inline uint64_t mapper_next_deadline(const Mapper *m) {
+    return action_engine_next_ns(&m->actions);
+}
+
+// The packet changed which layers are active. It is evaluated from scratch
+// under the new table with output muted, then only the difference goes
+// out: keys the old layers held and the new ones don't are released, new
+// ones pressed, and keys held under both stay down untouched.
+static inline void mapper_switch_layers(Mapper *m, unsigned layers,
+                                        const GipInputPacket *input, uint16_t buttons) {
+    bool held[256];
+    memcpy(held, m->state.keys, sizeof(held));
+    bool mouse_left = m->state.mouse_left;
+    bool mouse_right = m->state.mouse_right;
+    
+    action_engine_reset(&m->actions);
+    stick_pwm_reset(m);
+    key_stick_reset(m);
+    memset(m->state.keys, 0, sizeof(m->state.keys));
+    m->state.mouse_left = false;
+    m->state.mouse_right = false;
+    m->state.prev_buttons = 0;
+    m->state.prev_left_trigger = 0;
+    m->state.prev_right_trigger = 0;
+    mapper_use_layers(m, layers);
+    
+    OutputSink *sink = m->sink;
+    StickKeyStats stats = m->stick_stats;
+    OutputSink muted = null_sink_make();
+    m->sink = &muted;
+    m->actions.sink = &muted;
+    process_buttons(m, buttons);
+    process_triggers(m, input->left_trigger, input->right_trigger);
+    process_sticks(m, input->left_stick_x, input->left_stick_y,
+                   input->right_stick_x, input->right_stick_y);
+    m->sink = sink;
+    m->actions.sink = sink;
+    m->stick_stats = stats;
+    
+    // Compare 8 keys at a time and only visit the words that differ
+    uint32_t differ = 0;
+    for (int w = 0; w < 256 / 8; w++) {
+        uint64_t before, after;
+        memcpy(&before, held + w * 8, 8);
+        memcpy(&after, m->state.keys + w * 8, 8);
+        differ |= (uint32_t)(before != after) << w;
+    }
+    for (int pass = 0; pass < 2; pass++) {      // Releases first
+        bool pressed = pass == 1;
+        for (uint32_t words = differ; words; words &= words - 1) {
+            int w = __builtin_ctz(words);
+            for (int i = w * 8; i < w * 8 + 8; i++) {
+                if (held[i] != m->state.keys[i] && m->state.keys[i] == pressed) {
+                    sink_key(sink, i, pressed);
+                }
+            }
+        }
+        if (mouse_left != m->state.mouse_left && m->state.mouse_left == pressed) {
+            sink_mouse_button(sink, MOUSE_BUTTON_LEFT, pressed);
+        }
+        if (mouse_right != m->state.mouse_right && m->state.mouse_right == pressed) {
+            sink_mouse_button(sink, MOUSE_BUTTON_RIGHT, pressed);
+        }
+    }
+}
+
+// Run one decoded input packet through the pipeline
+static inline void mapper_process_input(Mapper *m, const GipInputPacket *input) {
+    // Packets at rest repeat the previous state exactly (only the header's
+    // sequence number changes); they can't produce any events
+    const uint8_t *payload = (const uint8_t *)input + sizeof(GipHeader);
+    if (m->state.have_prev_payload &&
+        memcmp(payload, m->state.prev_payload, sizeof(m->state.prev_payload)) == 0) {
+        return;
+    }
+    memcpy(m->state.prev_payload, payload, sizeof(m->state.prev_payload));
+    m->state.have_prev_payload = true;
+    
+    // Layer buttons only pick the table, they aren't keys themselves
+    uint16_t buttons = input->buttons;
+    if (m->profile->layer_mask) {
+        unsigned layers = profile_active_layers(m->profile, buttons);
+        buttons &= ~m->profile->layer_mask;
+        if (layers != m->layers) {
+            mapper_switch_layers(m, layers, input, buttons);
+            sink_flush(m->sink);
+            return;
+        }
+    }
+    
+    process_buttons(m, buttons);
+    process_triggers(m, input->left_trigger, input->right_trigger);
+    process_sticks(m, input->left_stick_x, input->left_stick_y,
+                   input->right_stick_x, input->right_stick_y);
+    
+    // Everything this packet changed reaches the OS together
+    sink_flush(m->sink);
+}
+
+// Release every key and mouse button this pipeline is holding down
+static inline void mapper_release_all(Mapper *m) {
+    for (int i = 0; i < 256; i++) {
+        if (m->state.keys[i]) {
+            sink_key(m->sink, i, false);
+            m->state.keys[i] = false;
+        }
+    }
+    if (m->state.mouse_left) {
+        sink_mouse_button(m->sink, MOUSE_BUTTON_LEFT, false);
+        m->state.mouse_left = false;
+    }
+    if (m->state.mouse_right) {
+        sink_mouse_button(m->sink, MOUSE_BUTTON_RIGHT, false);
+        m->state.mouse_right = false;
+    }
+    sink_flush(m->sink);
+}
+
+// Release everything and forget the previous input, so the next packet is
+// evaluated from scratch (after a mapping change or a reconnect)
+static inline void mapper_reset(Mapper *m) {
+    action_engine_reset(&m->actions);
+    stick_pwm_reset(m);
+    key_stick_reset(m);
+    mapper_release_all(m);
+    
+    m->state.prev_buttons = 0;
+    m->state.prev_left_trigger = 0;
+    m->state.prev_right_trigger = 0;
+    m->state.have_prev_payload = false;
+    memset(m->state.current_sticks, 0, sizeof(m->state.current_sticks));
+    memset(m->state.smoothed, 0, sizeof(m->state.smoothed));
+    m->state.mouse_dx = 0.0f;
+    m->state.mouse_dy = 0.0f;
+}
+
+// Switch to a different compiled profile. Everything held under the old
+// bindings is released and the change detection state is cleared, so the
+// next packet is evaluated from scratch under the new profile.
+static inline void mapper_set_profile(Mapper *m, const CompiledProfile *profile) {
+    mapper_reset(m);
+    m->profile = profile;
+    mapper_use_layers(m, 0);
+}
+
+#endif // MAPPER_H
@@ -0,0 +1,494 @@
+// output_sink.h
+// Output sink interface for translated keyboard/mouse events
+// The mapping code only talks to an OutputSink, so the same pipeline can
+// drive CoreGraphics, record into memory, or discard everything (headless).
+// Gamepad passthrough uses the same chain with whole-controller reports.
+
+#ifndef OUTPUT_SINK_H
+#define OUTPUT_SINK_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "timing.h"
+#include "hid_descriptor.h"
+
+typedef enum {
+    MOUSE_BUTTON_LEFT,
+    MOUSE_BUTTON_RIGHT,
+    MOUSE_BUTTON_MIDDLE
+} MouseButton;
+
+// Concrete sinks embed OutputSink as their first member and cast back in
+// their callbacks. flush marks the end of a frame (one input packet or one
+// output tick); sinks that buffer events deliver them there. gamepad is the
+// full state of virtual gamepad `pad` (one per controller); keyboard/mouse
+// sinks ignore it.
+typedef struct OutputSink OutputSink;
+struct OutputSink {
+    const char *name;
+    void (*key)(OutputSink *sink, uint16_t keycode, bool pressed);
+    void (*mouse_button)(OutputSink *sink, MouseButton button, bool pressed);
+    void (*mouse_move)(OutputSink *sink, float dx, float dy);
+    void (*gamepad)(OutputSink *sink, uint8_t pad, const GamepadReport *report);
+    void (*flush)(OutputSink *sink);
+};
+
+static inline void sink_key(OutputSink *sink, uint16_t keycode, bool pressed) {
+    sink->key(sink, keycode, pressed);
+}
+
+static inline void sink_mouse_button(OutputSink *sink, MouseButton button, bool pressed) {
+    sink->mouse_button(sink, button, pressed);
+}
+
+static inline void sink_mouse_move(OutputSink *sink, float dx, float dy) {
+    sink->mouse_move(sink, dx, dy);
+}
+
+static inline void sink_gamepad(OutputSink *sink, uint8_t pad, const GamepadReport *report) {
+    sink->gamepad(sink, pad, report);
+}
+
+static inline void sink_flush(OutputSink *sink) {
+    sink->flush(sink);
+}
+
+// For sinks that deliver every event immediately
+static inline void sink_flush_noop(OutputSink *sink) {
+    (void)sink;
+}
+
+// For sinks without a virtual gamepad
+static inline void sink_gamepad_noop(OutputSink *sink, uint8_t pad, const GamepadReport *report) {
+    (void)sink; (void)pad; (void)report;
+}
+
+// ============================================================================
+// Null Sink - discards everything (headless runs, measuring translation cost)
+// ============================================================================
+
+static inline void null_sink_key(OutputSink *sink, uint16_t keycode, bool pressed) {
+    (void)sink; (void)keycode; (void)pressed;
+}
+
+static inline void null_sink_mouse_button(OutputSink *sink, MouseButton button, bool pressed) {
+    (void)sink; (void)button; (void)pressed;
+}
+
+static inline void null_sink_mouse_move(OutputSink *sink, float dx, float dy) {
+    (void)sink; (void)dx; (void)dy;
+}
+
+static inline OutputSink null_sink_make(void) {
+    OutputSink sink = {
+        .name = "null",
+        .key = null_sink_key,
+        .mouse_button = null_sink_mouse_button,
+        .mouse_move = null_sink_mouse_move,
+        .gamepad = sink_gamepad_noop,
+        .flush = sink_flush_noop,
+    };
+    return sink;
+}
+
+// ============================================================================
+// Recording Sink - timestamped in-memory event log
+// ============================================================================
+
+typedef enum {
+    RECORDED_KEY,
+    RECORDED_MOUSE_BUTTON,
+    RECORDED_MOUSE_MOVE,
+    RECORDED_GAMEPAD
+} RecordedEventType;
+
+typedef struct {
+    uint64_t timestamp_ns;    // monotonic_ns() when the event reached the sink
+    RecordedEventType type;
+    uint16_t code;            // Keycode, MouseButton or gamepad number
+    bool pressed;
+    float dx, dy;             // Only for RECORDED_MOUSE_MOVE
+    GamepadReport gamepad;    // Only for RECORDED_GAMEPAD
+} RecordedEvent;
+
+typedef struct {
+    OutputSink base;
+    RecordedEvent *events;
+    size_t count;
+    size_t capacity;
+} RecordingSink;
+
+static inline RecordedEvent *recording_sink_append(RecordingSink *rec) {
+    if (rec->count == rec->capacity) {
+        size_t capacity = rec->capacity ? rec->capacity * 2 : 1024;
+        RecordedEvent *events = realloc(rec->events, capacity * sizeof(RecordedEvent));
+        if (!events) {
+            return NULL;
+        }
+        rec->events = events;
+        rec->capacity = capacity;
+    }
+    RecordedEvent *event = &rec->events[rec->count++];
+    event->timestamp_ns = monotonic_ns();
+    event->code = 0;
+    event->pressed = false;
+    event->dx = 0.0f;
+    event->dy = 0.0f;
+    return event;
+}
+
+static inline void recording_sink_key(OutputSink *sink, uint16_t keycode, bool pressed) {
+    RecordedEvent *event = recording_sink_append((RecordingSink *)sink);
+    if (event) {
+        event->type = RECORDED_KEY;
+        event->code = keycode;
+        event->pressed = pressed;
+    }
+}
+
+static inline void recording_sink_mouse_button(OutputSink *sink, MouseButton button, bool pressed) {
+    RecordedEvent *event = recording_sink_append((RecordingSink *)sink);
+    if (event) {
+        event->type = RECORDED_MOUSE_BUTTON;
+        event->code = (uint16_t)button;
+        event->pressed = pressed;
+    }
+}
+
+static inline void recording_sink_mouse_move(OutputSink *sink, float dx, float dy) {
+    RecordedEvent *event = recording_sink_append((RecordingSink *)sink);
+    if (event) {
+        event->type = RECORDED_MOUSE_MOVE;
+        event->dx = dx;
+        event->dy = dy;
+    }
+}
+
+static inline void recording_sink_gamepad(OutputSink *sink, uint8_t pad,
+                                          const GamepadReport *report) {
+    RecordedEvent *event = recording_sink_append((RecordingSink *)sink);
+    if (event) {
+        event->type = RECORDED_GAMEPAD;
+        event->code = pad;
+        event->gamepad = *report;
+    }
+}
+
+static inline void recording_sink_init(RecordingSink *rec) {
+    rec->base.name = "record";
+    rec->base.key = recording_sink_key;
+    rec->base.mouse_button = recording_sink_mouse_button;
+    rec->base.mouse_move = recording_sink_mouse_move;
+    rec->base.gamepad = recording_sink_gamepad;
+    rec->base.flush = sink_flush_noop;
+    rec->events = NULL;
+    rec->count = 0;
+    rec->capacity = 0;
+}
+
+static inline void recording_sink_free(RecordingSink *rec) {
+    free(rec->events);
+    rec->events = NULL;
+    rec->count = 0;
+    rec->capacity = 0;
+}
+
+// One line per event, timestamps relative to the first event:
+//   <ns> key <code> down|up
+//   <ns> button <left|right|middle> down|up
+//   <ns> move <dx> <dy>
+//   <ns> pad <n> <buttons> <lt> <rt> <lx> <ly> <rx> <ry>
+static inline void recording_sink_dump(const RecordingSink *rec, FILE *out) {
+    static const char *button_names[] = {"left", "right", "middle"};
+    uint64_t start = rec->count ? rec->events[0].timestamp_ns : 0;
+
+    for (size_t i = 0; i < rec->count; i++) {
+        const RecordedEvent *event = &rec->events[i];
+        unsigned long long t = (unsigned long long)(event->timestamp_ns - start);
+        switch (event->type) {
+            case RECORDED_KEY:
+                fprintf(out, "%llu key 0x%02x %s\n", t, event->code,
+                        event->pressed ? "down" : "up");
+                break;
+            case RECORDED_MOUSE_BUTTON:
+                fprintf(out, "%llu button %s %s\n", t,
+                        event->code <= MOUSE_BUTTON_MIDDLE ? button_names[event->code] : "?",
+                        event->pressed ? "down" : "up");
+                break;
+            case RECORDED_MOUSE_MOVE:
+                fprintf(out, "%llu move %.0f %.0f\n", t, event->dx, event->dy);
+                break;
+            case RECORDED_GAMEPAD:
+                fprintf(out, "%llu pad %u 0x%04x %u %u %d %d %d %d\n", t, event->code,
+                        event->gamepad.buttons, event->gamepad.left_trigger,
+                        event->gamepad.right_trigger, event->gamepad.left_stick_x,
+                        event->gamepad.left_stick_y, event->gamepad.right_stick_x,
+                        event->gamepad.right_stick_y);
+                break;
+        }
+    }
+}
+
+// ============================================================================
+// Fan-out Sink - forwards every event to several sinks in order
+// ============================================================================
+
+#define FANOUT_MAX_SINKS 4
+
+typedef struct {
+    OutputSink base;
+    OutputSink *sinks[FANOUT_MAX_SINKS];
+    int count;
+} FanoutSink;
+
+static inline void fanout_sink_key(OutputSink *sink, uint16_t keycode, bool pressed) {
+    FanoutSink *fan = (FanoutSink *)sink;
+    for (int i = 0; i < fan->count; i++) {
+        sink_key(fan->sinks[i], keycode, pressed);
+    }
+}
+
+static inline void fanout_sink_mouse_button(OutputSink *sink, MouseButton button, bool pressed) {
+    FanoutSink *fan = (FanoutSink *)sink;
+    for (int i = 0; i < fan->count; i++) {
+        sink_mouse_button(fan->sinks[i], button, pressed);
+    }
+}
+
+static inline void fanout_sink_mouse_move(OutputSink *sink, float dx, float dy) {
+    FanoutSink *fan = (FanoutSink *)sink;
+    for (int i = 0; i < fan->count; i++) {
+        sink_mouse_move(fan->sinks[i], dx, dy);
+    }
+}
+
+static inline void fanout_sink_gamepad(OutputSink *sink, uint8_t pad,
+                                       const GamepadReport *report) {
+    FanoutSink *fan = (FanoutSink *)sink;
+    for (int i = 0; i < fan->count; i++) {
+        sink_gamepad(fan->sinks[i], pad, report);
+    }
+}
+
+static inline void fanout_sink_flush(OutputSink *sink) {
+    FanoutSink *fan = (FanoutSink *)sink;
+    for (int i = 0; i < fan->count; i++) {
+        sink_flush(fan->sinks[i]);
+    }
+}
+
+static inline void fanout_sink_init(FanoutSink *fan) {
+    fan->base.name = "fanout";
+    fan->base.key = fanout_sink_key;
+    fan->base.mouse_button = fanout_sink_mouse_button;
+    fan->base.mouse_move = fanout_sink_mouse_move;
+    fan->base.gamepad = fanout_sink_gamepad;
+    fan->base.flush = fanout_sink_flush;
+    fan->count = 0;
+}
+
+// Returns false if the fan-out is already full
+static inline bool fanout_sink_add(FanoutSink *fan, OutputSink *sink) {
+    if (fan->count >= FANOUT_MAX_SINKS) {
+        return false;
+    }
+    fan->sinks[fan->count++] = sink;
+    return true;
+}
+
+// ============================================================================
+// Batch Sink - collects one frame of events and delivers them together
+// ============================================================================
+//
+// Every transition from one packet is buffered (no allocation), mouse moves
+// are merged into a single delta, and on flush the frame is delivered in a
+// fixed order: the merged move first (so clicks land at the new position),
+// then all releases, then all presses, each sorted by code. A gamepad report
+// is a whole state, so only the frame's latest one is delivered.
+
+#define BATCH_MAX_EVENTS 64
+
+typedef struct {
+    uint8_t type;       // RECORDED_KEY or RECORDED_MOUSE_BUTTON
+    bool pressed;
+    uint16_t code;
+} BatchedEvent;
+
+typedef struct {
+    OutputSink base;
+    OutputSink *target;
+    BatchedEvent events[BATCH_MAX_EVENTS];
+    int count;
+    float dx, dy;
+    bool has_move;
+    bool has_gamepad;
+    uint8_t pad;
+    GamepadReport gamepad;
+} BatchSink;
+
+// Releases before presses, keys before mouse buttons, then by code
+static inline int batch_event_rank(const BatchedEvent *e) {
+    return (e->pressed ? 0x40000 : 0) | (e->type == RECORDED_MOUSE_BUTTON ? 0x10000 : 0) | e->code;
+}
+
+static inline void batch_sink_flush(OutputSink *sink) {
+    BatchSink *batch = (BatchSink *)sink;
+
+    if (batch->has_gamepad) {
+        sink_gamepad(batch->target, batch->pad, &batch->gamepad);
+        batch->has_gamepad = false;
+    }
+
+    if (batch->has_move) {
+        sink_mouse_move(batch->target, batch->dx, batch->dy);
+        batch->has_move = false;
+        batch->dx = 0.0f;
+        batch->dy = 0.0f;
+    }
+
+    // Insertion sort: frames hold a handful of events
+    for (int i = 1; i < batch->count; i++) {
+        BatchedEvent e = batch->events[i];
+        int rank = batch_event_rank(&e);
+        int j = i - 1;
+        while (j >= 0 && batch_event_rank(&batch->events[j]) > rank) {
+            batch->events[j + 1] = batch->events[j];
+            j--;
+        }
+        batch->events[j + 1] = e;
+    }
+
+    for (int i = 0; i < batch->count; i++) {
+        const BatchedEvent *e = &batch->events[i];
+        if (e->type == RECORDED_KEY) {
+            sink_key(batch->target, e->code, e->pressed);
+        } else {
+            sink_mouse_button(batch->target, (MouseButton)e->code, e->pressed);
+        }
+    }
+    batch->count = 0;
+
+    sink_flush(batch->target);
+}
+
+static inline void batch_sink_push(BatchSink *batch, uint8_t type, uint16_t code, bool pressed) {
+    if (batch->count == BATCH_MAX_EVENTS) {
+        batch_sink_flush(&batch->base);
+    }
+    BatchedEvent *e = &batch->events[batch->count++];
+    e->type = type;
+    e->code = code;
+    e->pressed = pressed;
+}
+
+static inline void batch_sink_key(OutputSink *sink, uint16_t keycode, bool pressed) {
+    batch_sink_push((BatchSink *)sink, RECORDED_KEY, keycode, pressed);
+}
+
+static inline void batch_sink_mouse_button(OutputSink *sink, MouseButton button, bool pressed) {
+    batch_sink_push((BatchSink *)sink, RECORDED_MOUSE_BUTTON, (uint16_t)button, pressed);
+}
+
+static inline void batch_sink_mouse_move(OutputSink *sink, float dx, float dy) {
+    BatchSink *batch = (BatchSink *)sink;
+    batch->dx += dx;
+    batch->dy += dy;
+    batch->has_move = true;
+}
+
+static inline void batch_sink_gamepad(OutputSink *sink, uint8_t pad,
+                                      const GamepadReport *report) {
+    BatchSink *batch = (BatchSink *)sink;
+    if (batch->has_gamepad && batch->pad != pad) {
+        batch_sink_flush(sink);
+    }
+    batch->pad = pad;
+    batch->gamepad = *report;
+    batch->has_gamepad = true;
+}
+
+static inline void batch_sink_init(BatchSink *batch, OutputSink *target) {
+    batch->base.name = target->name;
+    batch->base.key = batch_sink_key;
+    batch->base.mouse_button = batch_sink_mouse_button;
+    batch->base.mouse_move = batch_sink_mouse_move;
+    batch->base.gamepad = batch_sink_gamepad;
+    batch->base.flush = batch_sink_flush;
+    batch->target = target;
+    batch->count = 0;
+    batch->dx = 0.0f;
+    batch->dy = 0.0f;
+    batch->has_move = false;
+    batch->has_gamepad = false;
+}
+
+// ============================================================================
+// Shared Sink - lets several controllers drive one output
+// ============================================================================
+//
+// Keys and mouse buttons are reference counted: the target sees a press
+// when the first controller presses and a release when the last one lets
+// go, so one pad releasing a key can't cut off another pad still holding it.
+// Gamepad reports pass straight through: each controller has its own pad.
+
+typedef struct {
+    OutputSink base;
+    OutputSink *target;
+    uint8_t key_holders[256];
+    uint8_t button_holders[MOUSE_BUTTON_MIDDLE + 1];
+} SharedSink;
+
+// Returns true when the press/release changes what the target should see
+static inline bool shared_sink_count(uint8_t *holders, bool pressed) {
+    if (pressed) {
+        return (*holders)++ == 0;
+    }
+    if (*holders == 0) {
+        return false;   // Nothing held
+    }
+    return --(*holders) == 0;
+}
+
+static inline void shared_sink_key(OutputSink *sink, uint16_t keycode, bool pressed) {
+    SharedSink *shared = (SharedSink *)sink;
+    if (keycode >= 256 || shared_sink_count(&shared->key_holders[keycode], pressed)) {
+        sink_key(shared->target, keycode, pressed);
+    }
+}
+
+static inline void shared_sink_mouse_button(OutputSink *sink, MouseButton button, bool pressed) {
+    SharedSink *shared = (SharedSink *)sink;
+    if (button > MOUSE_BUTTON_MIDDLE ||
+        shared_sink_count(&shared->button_holders[button], pressed)) {
+        sink_mouse_button(shared->target, button, pressed);
+    }
+}
+
+static inline void shared_sink_mouse_move(OutputSink *sink, float dx, float dy) {
+    sink_mouse_move(((SharedSink *)sink)->target, dx, dy);
+}
+
+static inline void shared_sink_gamepad(OutputSink *sink, uint8_t pad,
+                                       const GamepadReport *report) {
+    sink_gamepad(((SharedSink *)sink)->target, pad, report);
+}
+
+static inline void shared_sink_flush(OutputSink *sink) {
+    sink_flush(((SharedSink *)sink)->target);
+}
+
+static inline void shared_sink_init(SharedSink *shared, OutputSink *target) {
+    memset(shared, 0, sizeof(*shared));
+    shared->base.name = target->name;
+    shared->base.key = shared_sink_key;
+    shared->base.mouse_button = shared_sink_mouse_button;
+    shared->base.mouse_move = shared_sink_mouse_move;
+    shared->base.gamepad = shared_sink_gamepad;
+    shared->base.flush = shared_sink_flush;
+    shared->target = target;
+}
+
+#endif // OUTPUT_SINK_H
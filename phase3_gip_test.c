@@ -10,12 +10,17 @@
 #include <unistd.h>
 #include <libusb.h>
 #include "gip.h"
+#include "capture.h"
 
 #define XBOX_VENDOR_ID  0x045e
 #define XBOX_PRODUCT_ID 0x02dd
 
 static int running = 1;
 
+// Raw packet capture (--capture FILE)
+static CaptureWriter capture;
+static bool capturing = false;
+
 void signal_handler(int sig) {
     (void)sig;
     running = 0;
@@ -75,6 +80,10 @@ int initialize_controller(libusb_device_handle *handle, uint8_t in_endpoint, uin
             2000  // 2 second timeout
         );
         
+        if (result == 0 && capturing) {
+            capture_writer_write(&capture, monotonic_ns(), buffer, transferred);
+        }
+        
         if (result == 0 && transferred >= (int)sizeof(GipHeader)) {
             GipHeader *header = (GipHeader *)buffer;
             
@@ -162,6 +171,10 @@ void input_loop(libusb_device_handle *handle, uint8_t in_endpoint) {
             100  // 100ms timeout
         );
         
+        if (result == 0 && capturing) {
+            capture_writer_write(&capture, monotonic_ns(), buffer, transferred);
+        }
+        
         if (result == 0 && transferred >= (int)sizeof(GipHeader)) {
             GipHeader *header = (GipHeader *)buffer;
             
@@ -221,10 +234,19 @@ void input_loop(libusb_device_handle *handle, uint8_t in_endpoint) {
     printf("\n\n");
 }
 
-int main() {
+int main(int argc, char *argv[]) {
     libusb_context *ctx = NULL;
     libusb_device_handle *handle = NULL;
     int result;
+    const char *capture_path = NULL;
+    
+    // Optional: --capture FILE saves every packet for replay with the simulator
+    if (argc == 3 && strcmp(argv[1], "--capture") == 0) {
+        capture_path = argv[2];
+    } else if (argc != 1) {
+        printf("Usage: sudo %s [--capture FILE]\n", argv[0]);
+        return 1;
+    }
     
     // Set up signal handler for clean exit
     signal(SIGINT, signal_handler);
@@ -233,6 +255,15 @@ int main() {
     printf("Xbox One Controller GIP Protocol Test\n");
     printf("======================================\n\n");
     
+    if (capture_path) {
+        if (capture_writer_open(&capture, capture_path) < 0) {
+            printf("❌ Could not create capture %s\n", capture_path);
+            return 1;
+        }
+        capturing = true;
+        printf("📼 Capturing raw packets to %s\n\n", capture_path);
+    }
+    
     // Initialize libusb
     result = libusb_init(&ctx);
     if (result < 0) {
@@ -307,6 +338,11 @@ int main() {
     input_loop(handle, in_endpoint);
     
     // Cleanup
+    if (capturing) {
+        printf("📼 Saved %zu packets to %s\n", capture.count, capture_path);
+        capture_writer_close(&capture);
+    }
+    
     printf("Cleaning up...\n");
     libusb_release_interface(handle, 0);
     libusb_close(handle);
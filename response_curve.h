@@ -0,0 +1,146 @@
+// response_curve.h
+// Precomputed lookup tables for stick response curves
+// Curves are sampled once when the mapping is compiled; evaluating one per
+// tick is a table lookup and a linear interpolation instead of powf().
+
+#ifndef RESPONSE_CURVE_H
+#define RESPONSE_CURVE_H
+
+#include <stdint.h>
+#include <math.h>
+#include "keymapping.h"
+
+#define LUT_SIZE 256    // Segments per table (LUT_SIZE + 1 samples)
+
+// A function sampled at LUT_SIZE + 1 evenly spaced points over [0, 1]
+typedef struct {
+    float values[LUT_SIZE + 1];
+} Lut;
+
+// Interpolated value at x; x is clamped to [0, 1]
+static inline float lut_lookup(const Lut *lut, float x) {
+    float pos = x * LUT_SIZE;
+    if (!(pos > 0.0f)) {
+        return lut->values[0];
+    }
+    if (pos >= LUT_SIZE) {
+        return lut->values[LUT_SIZE];
+    }
+    int i = (int)pos;
+    float frac = pos - (float)i;
+    return lut->values[i] + (lut->values[i + 1] - lut->values[i]) * frac;
+}
+
+// Odd-symmetric curve lookup: f(-x) = -f(x)
+static inline float lut_lookup_signed(const Lut *lut, float x) {
+    return x < 0.0f ? -lut_lookup(lut, -x) : lut_lookup(lut, x);
+}
+
+// ============================================================================
+// Curve Construction
+// ============================================================================
+
+// Piecewise-linear through (0,0), the user points (sorted by x) and (1,1)
+static inline float curve_piecewise_at(const StickMapping *sticks, float x) {
+    float x0 = 0.0f, y0 = 0.0f;
+    for (int i = 0; i <= sticks->mouse_curve_point_count; i++) {
+        float x1 = 1.0f, y1 = 1.0f;
+        if (i < sticks->mouse_curve_point_count) {
+            x1 = sticks->mouse_curve_points[i][0];
+            y1 = sticks->mouse_curve_points[i][1];
+        }
+        if (x <= x1) {
+            return x1 > x0 ? y0 + (y1 - y0) * (x - x0) / (x1 - x0) : y1;
+        }
+        x0 = x1;
+        y0 = y1;
+    }
+    return 1.0f;
+}
+
+// Point at parameter t on the Bezier curve from (0,0) through the user
+// control points to (1,1) (de Casteljau)
+static inline void curve_bezier_at(const StickMapping *sticks, float t, float *x, float *y) {
+    float px[MOUSE_CURVE_MAX_POINTS + 2];
+    float py[MOUSE_CURVE_MAX_POINTS + 2];
+    int n = sticks->mouse_curve_point_count + 2;
+
+    px[0] = 0.0f;
+    py[0] = 0.0f;
+    for (int i = 0; i < sticks->mouse_curve_point_count; i++) {
+        px[i + 1] = sticks->mouse_curve_points[i][0];
+        py[i + 1] = sticks->mouse_curve_points[i][1];
+    }
+    px[n - 1] = 1.0f;
+    py[n - 1] = 1.0f;
+
+    for (int level = n - 1; level > 0; level--) {
+        for (int i = 0; i < level; i++) {
+            px[i] += (px[i + 1] - px[i]) * t;
+            py[i] += (py[i + 1] - py[i]) * t;
+        }
+    }
+    *x = px[0];
+    *y = py[0];
+}
+
+// Sample a Bezier curve as y(x). The curve is walked in small parameter
+// steps and each table entry is interpolated between the two samples that
+// straddle its x, so control points only need x to be non-decreasing.
+static inline void lut_build_bezier(Lut *lut, const StickMapping *sticks) {
+    const int steps = LUT_SIZE * 8;
+    float prev_x = 0.0f, prev_y = 0.0f;
+    int entry = 0;
+
+    lut->values[entry++] = 0.0f;
+    for (int s = 1; s <= steps && entry <= LUT_SIZE; s++) {
+        float x, y;
+        curve_bezier_at(sticks, (float)s / steps, &x, &y);
+        while (entry <= LUT_SIZE && (float)entry / LUT_SIZE <= x) {
+            float target = (float)entry / LUT_SIZE;
+            float frac = x > prev_x ? (target - prev_x) / (x - prev_x) : 1.0f;
+            lut->values[entry++] = prev_y + (y - prev_y) * frac;
+        }
+        prev_x = x;
+        prev_y = y;
+    }
+    while (entry <= LUT_SIZE) {
+        lut->values[entry++] = 1.0f;
+    }
+}
+
+// Sample the configured mouse response curve
+static inline void lut_build_mouse_curve(Lut *lut, const StickMapping *sticks) {
+    MouseCurveType type = sticks->mouse_curve_type;
+    if (sticks->mouse_curve_point_count == 0 ||
+        sticks->mouse_curve_point_count > MOUSE_CURVE_MAX_POINTS) {
+        type = MOUSE_CURVE_POWER;
+    }
+
+    switch (type) {
+        case MOUSE_CURVE_BEZIER:
+            lut_build_bezier(lut, sticks);
+            break;
+        case MOUSE_CURVE_PIECEWISE:
+            for (int i = 0; i <= LUT_SIZE; i++) {
+                lut->values[i] = curve_piecewise_at(sticks, (float)i / LUT_SIZE);
+            }
+            break;
+        case MOUSE_CURVE_POWER:
+        default:
+            for (int i = 0; i <= LUT_SIZE; i++) {
+                lut->values[i] = powf((float)i / LUT_SIZE, sticks->mouse_curve);
+            }
+            break;
+    }
+}
+
+// Smoothing weight for a tick covering `scale` reference ticks is
+// 1 - smoothing^scale. The table covers [0, max_scale].
+static inline void lut_build_smoothing(Lut *lut, float smoothing, float max_scale) {
+    for (int i = 0; i <= LUT_SIZE; i++) {
+        lut->values[i] = 1.0f - powf(smoothing, max_scale * i / LUT_SIZE);
+    }
+}
+
+#endif // RESPONSE_CURVE_H
@@ -0,0 +1,136 @@
+// rumble_socket.h
+// Local rumble API
+// Other processes send one-line text commands as datagrams to a UNIX
+// socket; the input loop picks them up without ever blocking:
+//
+//   rumble <controller|all> <left> <right> [<left trigger> <right trigger> [<ms>]]
+//   stop <controller|all>
+//   profile <controller|all> <name|auto>
+//
+// Motor strengths are 0-255. Controllers are numbered from 1, as in the
+// console output. Without a duration the effect lasts 1 second; the
+// controller caps it at 2.55 seconds. profile switches to the config file
+// of that name (without its extension); auto goes back to the usual
+// choice. Example:
+//
+//   echo "rumble 1 200 80" | socat - UNIX-SENDTO:/tmp/xbox-controller.sock
+
+#ifndef RUMBLE_SOCKET_H
+#define RUMBLE_SOCKET_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "console.h"
+
+#define RUMBLE_SOCKET_DEFAULT       "/tmp/xbox-controller.sock"
+#define RUMBLE_DEFAULT_DURATION_MS  1000
+#define RUMBLE_MAX_DURATION_MS      2550
+
+typedef struct {
+    int controller;             // 1-based; 0 = every controller
+    uint8_t left;               // Strong (low frequency) motor, 0-255
+    uint8_t right;              // Weak (high frequency) motor
+    uint8_t left_trigger;
+    uint8_t right_trigger;
+    uint16_t duration_ms;
+    char profile[32];           // Set for a profile command (the rest is unused)
+} RumbleRequest;
+
+// Parse one command line. Returns false if it isn't a valid command.
+static inline bool rumble_parse(const char *line, RumbleRequest *req) {
+    char verb[16];
+    char target[16];
+    int values[5] = {0, 0, 0, 0, RUMBLE_DEFAULT_DURATION_MS};
+    int n = sscanf(line, "%15s %15s %d %d %d %d %d", verb, target,
+                   &values[0], &values[1], &values[2], &values[3], &values[4]);
+
+    memset(req, 0, sizeof(*req));
+    if (n < 2) {
+        return false;
+    }
+    if (strcmp(target, "all") == 0) {
+        req->controller = 0;
+    } else if (sscanf(target, "%d", &req->controller) != 1 || req->controller < 1) {
+        return false;
+    }
+
+    if (strcmp(verb, "stop") == 0) {
+        return n == 2;
+    }
+    if (strcmp(verb, "profile") == 0) {
+        char extra[2];
+        return sscanf(line, "%*s %*s %31s %1s", req->profile, extra) == 1;
+    }
+    if (strcmp(verb, "rumble") != 0 || (n != 4 && n != 6 && n != 7)) {
+        return false;
+    }
+    for (int i = 0; i < 4; i++) {
+        if (values[i] < 0 || values[i] > 255) {
+            return false;
+        }
+    }
+    if (values[4] < 0) {
+        return false;
+    }
+    req->left = (uint8_t)values[0];
+    req->right = (uint8_t)values[1];
+    req->left_trigger = (uint8_t)values[2];
+    req->right_trigger = (uint8_t)values[3];
+    req->duration_ms = (uint16_t)(values[4] < RUMBLE_MAX_DURATION_MS ? values[4] : RUMBLE_MAX_DURATION_MS);
+    return true;
+}
+
+// Create a non-blocking datagram socket at path, replacing a stale one.
+// Any local user may send to it. Returns the descriptor or -1.
+static inline int rumble_socket_open(const char *path) {
+    struct sockaddr_un addr;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    unlink(path);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) < 0) {
+        close(fd);
+        return -1;
+    }
+    chmod(path, 0666);      // The simulator runs as root; let users send
+    return fd;
+}
+
+// Next valid request, if any. Malformed commands are reported to log and
+// skipped.
+static inline bool rumble_socket_receive(int fd, RumbleRequest *req, ConsoleLog *log) {
+    char line[128];
+    ssize_t n;
+    while ((n = recv(fd, line, sizeof(line) - 1, 0)) >= 0) {
+        line[n] = '\0';
+        if (rumble_parse(line, req)) {
+            return true;
+        }
+        line[strcspn(line, "\r\n")] = '\0';
+        console_log(log, "⚠️  Ignoring rumble command: %s\n", line);
+    }
+    return false;
+}
+
+static inline void rumble_socket_close(int fd, const char *path) {
+    close(fd);
+    unlink(path);
+}
+
+#endif // RUMBLE_SOCKET_H
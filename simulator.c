@@ -9,545 +9,1268 @@
 #include <string.h>
 #include <signal.h>
 #include <unistd.h>
-#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include <libusb.h>
-#include <ApplicationServices/ApplicationServices.h>
 #include "gip.h"
 #include "keymapping.h"
+#include "usb_transport.h"
+#include "timing.h"
+#include "output_sink.h"
+#include "sink_coregraphics.h"
+#include "sink_uinput.h"
+#include "sink_uhid.h"
+#include "mapper.h"
+#include "capture.h"
+#include "latency.h"
+#include "config_file.h"
+#include "config_watch.h"
+#include "controller.h"
+#include "hotplug.h"
+#include "rumble_socket.h"
+#include "input_ring.h"
+#include "console.h"
+#include "frontmost_app.h"
 
-#define XBOX_VENDOR_ID  0x045e
-#define XBOX_PRODUCT_ID 0x02dd
-
-static int running = 1;
+static volatile sig_atomic_t running = 1;
+static volatile sig_atomic_t latency_dump_requested = 0;
 static ControllerMapping config;
+static CompiledProfile compiled;
+
+// Every controller (USB or replayed) has its own pipeline
+static Controller controllers[MAX_CONTROLLERS];
+static atomic_int controller_count = 0;
+
+// All controllers feed one output: shared -> timed -> (fan-out ->) target.
+// The timed sink measures time spent posting for the latency histograms.
+static SharedSink shared_sink;
+static TimedSink timed_sink;
+
+// --gamepad: each packet goes out unchanged as a virtual gamepad report,
+// skipping the keyboard/mouse translation
+static bool gamepad_passthrough = false;
+
+// Raw packet capture (--capture), one file per controller
+static const char *capture_path = NULL;
+
+// Runtime config files, reloaded when they change. Controller n follows the
+// nth --config file; extra controllers follow the last one. --profile files
+// are only used when picked by name over the socket, or because they list
+// the frontmost application. Each is named after its file.
+#define MAX_CONFIGS 16
+static const char *config_paths[MAX_CONFIGS];
+static char config_names[MAX_CONFIGS][32];
+static ConfigWatcher config_watchers[MAX_CONFIGS];
+static int config_count = 0;
+static int default_configs[MAX_CONTROLLERS];     // Indexes of the --config files
+static int default_count = 0;
 
-// State tracking for keys (prevent redundant events)
-typedef struct {
-    bool keys[256];           // Track which keys are currently pressed
-    bool mouse_left;          // Left mouse button state
-    bool mouse_right;         // Right mouse button state
-    bool mouse_middle;        // Middle mouse button state
-    
-    // Previous controller state for change detection
-    uint16_t prev_buttons;
-    uint8_t prev_left_trigger;
-    uint8_t prev_right_trigger;
-    int16_t prev_left_stick_x;
-    int16_t prev_left_stick_y;
-    int16_t prev_right_stick_x;
-    int16_t prev_right_stick_y;
-    
-    // Current stick positions (for continuous movement)
-    int16_t current_left_stick_x;
-    int16_t current_left_stick_y;
-    int16_t current_right_stick_x;
-    int16_t current_right_stick_y;
-    
-    // Smoothed stick positions (for mouse mode)
-    float smoothed_right_x;
-    float smoothed_right_y;
-    float smoothed_left_x;
-    float smoothed_left_y;
-    
-    // Mouse delta accumulation
-    float mouse_dx;
-    float mouse_dy;
-} InputState;
-
-static InputState input_state = {0};
+// Frontmost application (macOS window list, or --frontmost-file), for
+// profiles with an apps list. Only read by whichever thread translates.
+static FrontmostWatcher frontmost;
+static bool frontmost_running = false;
+static const char *frontmost_path = NULL;
+static unsigned frontmost_seen = 0;
+static char frontmost_name[PROFILE_APP_NAME_MAX];
+static int app_config = -1;         // Config file listing it, -1 = none
+
+// Local rumble API (--rumble-socket)
+static const char *rumble_path = RUMBLE_SOCKET_DEFAULT;
+static int rumble_fd = -1;
+
+// Live controllers: the main thread reads USB and decodes, and hands input
+// snapshots over this ring to the injector thread, which translates and
+// posts them, so a slow post never delays the next read. NULL means input
+// is translated inline (replay, which must stay deterministic).
+static InputRing handoff_ring;
+static InputRing *input_ring = NULL;
+static atomic_bool injector_stop;
+
+// Capture time of the packet being replayed. Timed actions (tap/hold,
+// turbo, macros) run on this clock in a replay, so they fire at the same
+// points in the input at any replay speed.
+static uint64_t replay_clock_ns = 0;
+
+// While the simulator runs, everything printed goes through the log queue
+// and the renderer thread, which also draws the live input display
+static ConsoleLog log_queue;
+static atomic_bool renderer_stop;
+static bool status_line_shown = false;
 
 // ============================================================================
-// Event Injection Functions
+// GIP Protocol Functions (from phase3)
 // ============================================================================
 
-void send_key_event(uint16_t keycode, bool pressed) {
-    CGEventRef event = CGEventCreateKeyboardEvent(NULL, (CGKeyCode)keycode, pressed);
-    if (event) {
-        CGEventPost(kCGHIDEventTap, event);
-        CFRelease(event);
+void signal_handler(int sig) {
+    (void)sig;
+    running = 0;
+    console_log(&log_queue, "Shutting down...\n");
+}
+
+// SIGUSR1: print latency histograms from the main loop (not from the handler)
+void latency_signal_handler(int sig) {
+    (void)sig;
+    latency_dump_requested = 1;
+}
+
+void print_latency(FILE *out) {
+    for (int i = 0; i < controller_count; i++) {
+        char label[32];
+        snprintf(label, sizeof(label), "controller %d", controllers[i].number);
+        latency_dump(&controllers[i].latency, controller_count > 1 ? label : NULL, out);
     }
 }
 
-void send_mouse_button_event(CGMouseButton button, bool pressed) {
-    CGPoint currentPos;
-    CGEventRef getPos = CGEventCreate(NULL);
-    currentPos = CGEventGetLocation(getPos);
-    CFRelease(getPos);
+void check_latency_dump(void) {
+    if (latency_dump_requested) {
+        latency_dump_requested = 0;
+        print_latency(stderr);
+    }
+}
+
+// Pick up profiles published by the config watchers, and follow profile
+// selections and the frontmost application. Called between packets by
+// whichever thread translates input, where no mapper holds a pointer into
+// an old profile. A controller follows, in order: a profile picked over
+// the socket, a profile listing the frontmost application, its own file.
+void check_config_reload(void) {
+    if (config_count == 0) {
+        return;
+    }
+    static CompiledProfile *seen[MAX_CONFIGS];
+    CompiledProfile *current[MAX_CONFIGS];
+    uint64_t generations[MAX_CONFIGS];
+    bool changed = false;
+    for (int p = 0; p < config_count; p++) {
+        current[p] = config_watch_current(&config_watchers[p], &generations[p]);
+        changed |= current[p] != seen[p];
+        seen[p] = current[p];
+    }
     
-    CGEventType eventType;
-    switch (button) {
-        case kCGMouseButtonLeft:
-            eventType = pressed ? kCGEventLeftMouseDown : kCGEventLeftMouseUp;
-            break;
-        case kCGMouseButtonRight:
-            eventType = pressed ? kCGEventRightMouseDown : kCGEventRightMouseUp;
-            break;
-        case kCGMouseButtonCenter:
-            eventType = pressed ? kCGEventOtherMouseDown : kCGEventOtherMouseUp;
-            break;
-        default:
-            return;
+    // Matched again only when the application or an apps list may differ
+    if (frontmost_running && frontmost_watch_read(&frontmost, &frontmost_seen, frontmost_name)) {
+        changed = true;
+    }
+    if (changed) {
+        app_config = -1;
+        for (int p = 0; p < config_count && frontmost_name[0]; p++) {
+            if (frontmost_app_matches(&current[p]->tables[0].config.profile, frontmost_name)) {
+                app_config = p;
+                break;
+            }
+        }
     }
     
-    CGEventRef event = CGEventCreateMouseEvent(NULL, eventType, currentPos, button);
-    if (event) {
-        CGEventPost(kCGHIDEventTap, event);
-        CFRelease(event);
+    for (int i = 0; i < controller_count; i++) {
+        Controller *c = &controllers[i];
+        if (!c->attached) {
+            continue;
+        }
+        int selected = atomic_load(&c->selected_profile);
+        int p = selected >= 0 ? selected : app_config >= 0 ? app_config : c->profile;
+        const CompiledProfile *profile = p >= 0 ? current[p] : &compiled;
+        if (c->mapper.profile == profile) {
+            continue;
+        }
+        if (p != c->following) {
+            console_log(&log_queue, "🎯 Controller %d: profile %s%s%s%s\n", c->number,
+                        p >= 0 ? config_names[p] : "built-in",
+                        selected >= 0 ? " (selected)" : "",
+                        selected < 0 && p == app_config ? " for " : "",
+                        selected < 0 && p == app_config ? frontmost_name : "");
+            c->following = p;
+        }
+        mapper_set_profile(&c->mapper, profile);
+    }
+    
+    for (int p = 0; p < config_count; p++) {
+        config_watch_quiescent(&config_watchers[p], generations[p]);
     }
 }
 
-void send_mouse_movement(float dx, float dy) {
-    if (dx == 0.0f && dy == 0.0f) {
+// Queue a packet for the controller (acks from the decoder, our own
+// commands). Never blocks. Replayed controllers have nowhere to send to.
+void gip_send(void *user, const uint8_t *packet, int length) {
+    Controller *c = (Controller *)user;
+    if (!c->handle) {
         return;
     }
     
-    CGPoint currentPos;
-    CGEventRef getPos = CGEventCreate(NULL);
-    currentPos = CGEventGetLocation(getPos);
-    CFRelease(getPos);
-    
-    CGEventRef event;
-    
-    if (config.streaming_mode) {
-        // Streaming mode: Use delta fields (for Moonlight, Parsec, etc.)
-        event = CGEventCreateMouseEvent(NULL, kCGEventMouseMoved, currentPos, 0);
-        if (event) {
-            CGEventSetIntegerValueField(event, kCGMouseEventDeltaX, (int64_t)dx);
-            CGEventSetIntegerValueField(event, kCGMouseEventDeltaY, (int64_t)dy);
+    if (usb_output_send(&c->output, packet, length, false) && config.console_output_enabled) {
+        console_log(&log_queue, "  → Sent %s (seq=%d)\n", gip_command_name(packet[0]), packet[2]);
+    }
+}
+
+void send_power_on(Controller *c) {
+    uint8_t power_on[] = {GIP_CMD_POWER, GIP_OPT_INTERNAL, c->out_sequence++, 0x01, 0x00};
+    gip_send(c, power_on, sizeof(power_on));
+}
+
+// Start (or with all strengths zero, stop) rumble. A rumble still waiting
+// to be sent is replaced, so bursts of updates collapse to the latest one.
+void send_rumble(Controller *c, const RumbleRequest *req) {
+    GipRumblePacket rumble = {
+        .header = {GIP_CMD_RUMBLE, 0x00, c->out_sequence++, sizeof(GipRumblePacket) - sizeof(GipHeader)},
+        .motors = GIP_RUMBLE_ALL,
+        .magnitude_trigger_left = req->left_trigger * 100 / 255,
+        .magnitude_trigger_right = req->right_trigger * 100 / 255,
+        .magnitude_left = req->left * 100 / 255,
+        .magnitude_right = req->right * 100 / 255,
+        .duration = req->duration_ms / 10,
+    };
+    if (c->handle) {
+        usb_output_send(&c->output, (const uint8_t *)&rumble, sizeof(rumble), true);
+    }
+}
+
+// Apply rumble and profile commands that arrived on the socket since the
+// last call. Profile choices are picked up by check_config_reload().
+void check_rumble_requests(void) {
+    RumbleRequest req;
+    while (rumble_fd >= 0 && rumble_socket_receive(rumble_fd, &req, &log_queue)) {
+        int selected = -1;
+        if (req.profile[0] && strcmp(req.profile, "auto") != 0) {
+            while (++selected < config_count && strcmp(config_names[selected], req.profile) != 0) {
+            }
+            if (selected == config_count) {
+                console_log(&log_queue, "⚠️  No profile named %s\n", req.profile);
+                continue;
+            }
+        }
+        for (int i = 0; i < controller_count; i++) {
+            Controller *c = &controllers[i];
+            if (req.controller != 0 && req.controller != c->number) {
+                continue;
+            }
+            if (req.profile[0]) {
+                atomic_store(&c->selected_profile, selected);
+            } else if (c->active) {
+                send_rumble(c, &req);
+            }
         }
-    } else {
-        // Local mode: Use absolute positioning (for native macOS apps)
-        CGPoint newPos = CGPointMake(currentPos.x + dx, currentPos.y + dy);
-        event = CGEventCreateMouseEvent(NULL, kCGEventMouseMoved, newPos, 0);
     }
+}
+
+// Carry out what the handshake asked for
+void run_handshake_actions(Controller *c, unsigned actions) {
+    GipHandshake *h = &c->handshake;
     
-    if (event) {
-        CGEventPost(kCGHIDEventTap, event);
-        CFRelease(event);
+    if (actions & GIP_ACTION_SEND_POWER_ON) {
+        send_power_on(c);
+    }
+    if (actions & GIP_ACTION_READY) {
+        char unplugged[48] = "";
+        if (c->disconnected_ns) {
+            snprintf(unplugged, sizeof(unplugged), ", %.2f s after it was unplugged",
+                     (double)(h->ready_ns - c->disconnected_ns) / NS_PER_SEC);
+        }
+        console_log(&log_queue, "⚡ Controller %d ready: first input %.1f ms after connect%s\n",
+                    c->number, (double)(h->ready_ns - h->started_ns) / NS_PER_MS, unplugged);
+    }
+    if (actions & GIP_ACTION_GAVE_UP) {
+        console_log(&log_queue, "⚠️  Controller %d: no input after %d power-on attempts, still listening\n",
+                    c->number, h->attempts);
     }
 }
 
 // ============================================================================
-// Input Processing Functions
+// Console (renderer thread)
 // ============================================================================
 
-void apply_deadzone(int16_t *x, int16_t *y, int16_t deadzone) {
-    float magnitude = sqrtf((float)(*x) * (*x) + (float)(*y) * (*y));
-    
-    if (magnitude < deadzone) {
-        *x = 0;
-        *y = 0;
-    } else if (magnitude > 32767) {
-        // Normalize if outside unit circle
-        float scale = 32767.0f / magnitude;
-        *x = (int16_t)(*x * scale);
-        *y = (int16_t)(*y * scale);
-    }
-}
-
-void process_buttons(uint16_t buttons) {
-    // Check each button for state changes
-    struct {
-        uint16_t mask;
-        uint16_t keycode;
-    } button_map[] = {
-        {XBOX_BTN_A, config.buttons.key_a},
-        {XBOX_BTN_B, config.buttons.key_b},
-        {XBOX_BTN_X, config.buttons.key_x},
-        {XBOX_BTN_Y, config.buttons.key_y},
-        {XBOX_BTN_LB, config.buttons.key_lb},
-        {XBOX_BTN_RB, config.buttons.key_rb},
-        {XBOX_BTN_LS, config.buttons.key_ls},
-        {XBOX_BTN_RS, config.buttons.key_rs},
-        {XBOX_BTN_VIEW, config.buttons.key_view},
-        {XBOX_BTN_MENU, config.buttons.key_menu},
-        {XBOX_BTN_DPAD_UP, config.buttons.key_dpad_up},
-        {XBOX_BTN_DPAD_DOWN, config.buttons.key_dpad_down},
-        {XBOX_BTN_DPAD_LEFT, config.buttons.key_dpad_left},
-        {XBOX_BTN_DPAD_RIGHT, config.buttons.key_dpad_right}
-    };
+void print_status_line(const Controller *c, int input_count, const GipInputPacket *input) {
+    // With several controllers each line says which one it is
+    char tag[8] = "";
+    if (controller_count > 1) {
+        snprintf(tag, sizeof(tag), "P%d ", c->number);
+    }
+    printf("\r%s[%04d] ", tag, input_count);
+    printf("BTN: ");
+    if (input->buttons) {
+        print_buttons(input->buttons);
+    } else {
+        printf("none ");
+    }
+    printf("%-40s", "");
+    printf("\r%s[%04d] BTN: ", tag, input_count);
+    print_buttons(input->buttons);
+    printf("| LT:%3d RT:%3d ", input->left_trigger, input->right_trigger);
+    printf("| LS:(%6d,%6d) RS:(%6d,%6d)  ",
+           input->left_stick_x, input->left_stick_y,
+           input->right_stick_x, input->right_stick_y);
+}
+
+// One frame: redraw the status line for each controller whose input
+// changed, then print queued messages (moving off the status line first)
+void render_console(void) {
+    static int shown_count[MAX_CONTROLLERS];
+    static unsigned long dropped_reported = 0;
+    char text[CONSOLE_LINE_MAX];
     
-    for (int i = 0; i < 14; i++) {
-        bool is_pressed = (buttons & button_map[i].mask) != 0;
-        bool was_pressed = (input_state.prev_buttons & button_map[i].mask) != 0;
-        
-        if (is_pressed != was_pressed) {
-            send_key_event(button_map[i].keycode, is_pressed);
-            input_state.keys[button_map[i].keycode] = is_pressed;
+    if (config.console_output_enabled) {
+        for (int i = 0; i < controller_count; i++) {
+            int input_count;
+            GipInputPacket input;
+            if (console_status_read(&controllers[i].display, &input_count, &input) &&
+                input_count != shown_count[i]) {
+                shown_count[i] = input_count;
+                print_status_line(&controllers[i], input_count, &input);
+                status_line_shown = true;
+            }
         }
     }
     
-    input_state.prev_buttons = buttons;
+    while (console_log_pop(&log_queue, text)) {
+        if (status_line_shown) {
+            putchar('\n');
+            status_line_shown = false;
+        }
+        fputs(text, stdout);
+    }
+    unsigned long dropped = atomic_load(&log_queue.dropped);
+    if (dropped != dropped_reported) {
+        printf("%s⚠️  %lu console messages dropped\n", status_line_shown ? "\n" : "",
+               dropped - dropped_reported);
+        dropped_reported = dropped;
+        status_line_shown = false;
+    }
+    fflush(stdout);
 }
 
-void process_triggers(uint8_t left_trigger, uint8_t right_trigger) {
-    // Right trigger (swapped - GIP packet has them reversed)
-    bool right_pressed = left_trigger > config.triggers.threshold;
-    bool right_was_pressed = input_state.prev_right_trigger > config.triggers.threshold;
-    
-    if (right_pressed != right_was_pressed) {
-        if (config.triggers.right_trigger_mode == TRIGGER_MODE_MOUSE) {
-            send_mouse_button_event(kCGMouseButtonRight, right_pressed);
-            input_state.mouse_right = right_pressed;
-        } else if (config.triggers.right_trigger_mode == TRIGGER_MODE_KEY) {
-            send_key_event(config.triggers.right_trigger_key, right_pressed);
-            input_state.keys[config.triggers.right_trigger_key] = right_pressed;
+void *renderer_thread(void *arg) {
+    (void)arg;
+    uint64_t next_ns = monotonic_ns();
+    while (!atomic_load(&renderer_stop)) {
+        render_console();
+        next_ns += NS_PER_SEC / CONSOLE_REFRESH_HZ;
+        sleep_until_ns(next_ns);
+    }
+    render_console();
+    if (status_line_shown) {
+        putchar('\n');
+        status_line_shown = false;
+    }
+    return NULL;
+}
+
+// ============================================================================
+// Injection (injector thread, or inline when replaying)
+// ============================================================================
+
+// Translate one event from the reader. picked_ns is when it was taken off
+// the ring; clock_ns is the time timed actions see (picked_ns live, the
+// capture time when replaying).
+void apply_input_event(const InputEvent *event, uint64_t picked_ns, uint64_t clock_ns) {
+    Controller *c = &controllers[event->controller];
+    
+    if (event->type == INPUT_EVENT_CONNECTED) {
+        c->attached = true;
+        check_config_reload();      // Start with its profile's current mapping
+        return;
+    }
+    if (event->type == INPUT_EVENT_DISCONNECTED) {
+        // Let go of everything it was holding and forget its last packet,
+        // so it starts from a clean state if it comes back. Reloads skip
+        // detached controllers and may free the profile meanwhile, so drop
+        // it: the reload on reattach then always binds the current one.
+        mapper_reset(&c->mapper);
+        c->mapper.profile = NULL;
+        if (gamepad_passthrough) {
+            GamepadReport neutral = {0};
+            sink_gamepad(&c->batch.base, event->controller, &neutral);
+            sink_flush(&c->batch.base);
         }
+        c->attached = false;
+        return;
+    }
+    if (!c->attached) {
+        return;
     }
     
-    // Left trigger (swapped - GIP packet has them reversed)
-    bool left_pressed = right_trigger > config.triggers.threshold;
-    bool left_was_pressed = input_state.prev_left_trigger > config.triggers.threshold;
+    const GipInputPacket *input = &event->input;
+    c->input_count++;
+    
+    // Process and inject input events (updates stick positions)
+    timed_sink.elapsed_ns = 0;
+    mapper_advance(&c->mapper, clock_ns);
+    if (gamepad_passthrough) {
+        GamepadReport report;
+        gamepad_report_from_gip(input, &report);
+        sink_gamepad(&c->batch.base, event->controller, &report);
+        sink_flush(&c->batch.base);
+    } else {
+        mapper_process_input(&c->mapper, input);
+    }
+    latency_record_packet(&c->latency, event->complete_ns, event->start_ns, event->decoded_ns,
+                          picked_ns, monotonic_ns(), timed_sink.elapsed_ns);
     
-    if (left_pressed != left_was_pressed) {
-        if (config.triggers.left_trigger_mode == TRIGGER_MODE_MOUSE) {
-            send_mouse_button_event(kCGMouseButtonLeft, left_pressed);
-            input_state.mouse_left = left_pressed;
-        } else if (config.triggers.left_trigger_mode == TRIGGER_MODE_KEY) {
-            send_key_event(config.triggers.left_trigger_key, left_pressed);
-            input_state.keys[config.triggers.left_trigger_key] = left_pressed;
+    // Live display: only a snapshot here, the renderer draws it
+    if (config.console_output_enabled) {
+        console_status_publish(&c->display, c->input_count, input);
+    }
+}
+
+// Reader side: pass an event on to the injector (never waits for it unless
+// the hand-off backlog is full of button changes)
+void deliver_event(const InputEvent *event) {
+    if (input_ring) {
+        input_ring_send(input_ring, event);
+    } else {
+        apply_input_event(event, event->decoded_ns, replay_clock_ns);
+    }
+}
+
+void send_controller_event(Controller *c, InputEventType type) {
+    InputEvent event = {
+        .type = (uint8_t)type,
+        .controller = (uint8_t)(c - controllers),
+        .decoded_ns = monotonic_ns(),
+    };
+    deliver_event(&event);
+}
+
+// Translate input until told to stop. Mouse output runs on its own
+// monotonic clock; the thread sleeps until the next tick, the next timed
+// action or the next event.
+void *injector_thread(void *arg) {
+    InputRing *ring = (InputRing *)arg;
+    TickScheduler ticks;
+    tick_scheduler_init(&ticks, config.output_rate_hz, monotonic_ns());
+    
+    for (;;) {
+        // Checked before draining, so events published before the stop
+        // request are still translated
+        bool stopping = atomic_load(&injector_stop);
+        InputEvent event;
+        while (input_ring_pop(ring, &event)) {
+            uint64_t now = monotonic_ns();
+            apply_input_event(&event, now, now);
+        }
+        if (stopping) {
+            break;
         }
+        
+        uint64_t now = monotonic_ns();
+        uint64_t dt;
+        bool tick = tick_scheduler_due(&ticks, now, &dt);
+        uint64_t wake = ticks.next_ns;
+        for (int i = 0; i < controller_count; i++) {
+            Controller *c = &controllers[i];
+            if (!c->attached) {
+                continue;
+            }
+            mapper_advance(&c->mapper, now);
+            if (tick) {
+                output_tick(&c->mapper, dt);
+            }
+            uint64_t deadline = mapper_next_deadline(&c->mapper);
+            if (deadline < wake) {
+                wake = deadline;
+            }
+        }
+        
+        check_latency_dump();
+        check_config_reload();
+        input_ring_wait(ring, wake);
     }
-    
-    input_state.prev_left_trigger = right_trigger;  // Swapped
-    input_state.prev_right_trigger = left_trigger;  // Swapped
+    return NULL;
 }
 
-void process_stick_as_keys(int16_t x, int16_t y, uint16_t key_up, uint16_t key_down, 
-                           uint16_t key_left, uint16_t key_right) {
-    // Axes are swapped in the controller - swap them back
-    // Physical up/down is reported in X, physical left/right is reported in Y
-    int16_t temp = x;
-    x = y;
-    y = temp;
-    
-    // Normalize to -1.0 to 1.0
-    float norm_x = x / 32767.0f;
-    float norm_y = y / 32767.0f;
+// ============================================================================
+// GIP Message Handlers
+// ============================================================================
+
+// Announce: the controller (re)started its session
+void on_gip_announce(void *user, const GipMessage *msg) {
+    Controller *c = (Controller *)user;
+    gip_decoder_reset(&c->decoder);
+    
+    if (config.console_output_enabled && msg->length >= 20) {
+        const uint8_t *p = msg->payload;
+        console_log(&log_queue, "📣 Controller %d announced: %04x:%04x, firmware %u.%u.%u.%u\n",
+                    c->number, gip_le16(p + 8), gip_le16(p + 10),
+                    gip_le16(p + 12), gip_le16(p + 14), gip_le16(p + 16), gip_le16(p + 18));
+    }
+}
+
+// Status: battery level and type, sent periodically; report changes only
+void on_gip_status(void *user, const GipMessage *msg) {
+    static const char *levels[] = {"critical", "low", "medium", "full"};
+    static const char *types[] = {"none", "standard", "rechargeable", "unknown"};
+    Controller *c = (Controller *)user;
     
-    // Determine which directions are active (with threshold)
-    bool up = (norm_y > 0.3f);
-    bool down = (norm_y < -0.3f);
-    bool left = (norm_x < -0.3f);
-    bool right = (norm_x > 0.3f);
+    if (msg->length < 1 || msg->payload[0] == c->status) {
+        return;
+    }
+    c->status = msg->payload[0];
     
-    // Send key events for state changes
-    if (up != input_state.keys[key_up]) {
-        send_key_event(key_up, up);
-        input_state.keys[key_up] = up;
+    if (config.console_output_enabled) {
+        console_log(&log_queue, "🔋 Controller %d battery: %s (%s)\n", c->number,
+                    levels[c->status & 0x03], types[(c->status >> 2) & 0x03]);
     }
-    if (down != input_state.keys[key_down]) {
-        send_key_event(key_down, down);
-        input_state.keys[key_down] = down;
+}
+
+// Identify: the controller's (chunked) capability descriptor
+void on_gip_identify(void *user, const GipMessage *msg) {
+    Controller *c = (Controller *)user;
+    if (config.console_output_enabled) {
+        console_log(&log_queue, "ℹ️  Controller %d identified itself (%u-byte descriptor)\n",
+                    c->number, msg->length);
     }
-    if (left != input_state.keys[key_left]) {
-        send_key_event(key_left, left);
-        input_state.keys[key_left] = left;
+}
+
+void on_gip_guide(void *user, const GipMessage *msg) {
+    Controller *c = (Controller *)user;
+    if (config.console_output_enabled && msg->length >= 1 && msg->payload[0]) {
+        console_log(&log_queue, "🎮 GUIDE BUTTON PRESSED (controller %d)\n", c->number);
     }
-    if (right != input_state.keys[key_right]) {
-        send_key_event(key_right, right);
-        input_state.keys[key_right] = right;
+}
+
+void on_gip_serial(void *user, const GipMessage *msg) {
+    Controller *c = (Controller *)user;
+    if (!config.console_output_enabled) {
+        return;
+    }
+    char serial[64];
+    size_t n = 0;
+    for (uint32_t i = 0; i < msg->length && n < sizeof(serial) - 1; i++) {
+        if (msg->payload[i] >= 0x20 && msg->payload[i] < 0x7F) {
+            serial[n++] = (char)msg->payload[i];
+        }
     }
+    serial[n] = '\0';
+    console_log(&log_queue, "🔢 Controller %d serial number: %s\n", c->number, serial);
 }
 
-void process_stick_as_mouse(int16_t x, int16_t y, float *smoothed_x, float *smoothed_y) {
-    // Axes are swapped in the controller - swap them back
-    // Physical up/down is reported in X, physical left/right is reported in Y
-    int16_t temp = x;
-    x = y;
-    y = temp;
-    
-    // Normalize to -1.0 to 1.0
-    float target_x = x / 32767.0f;
-    float target_y = -y / 32767.0f;  // Invert Y - pushing up should move cursor up
-    
-    // Exponential smoothing (higher smoothing = smoother but more lag)
-    // alpha determines how much of the new value vs old value to use
-    // smoothing = 0.0 means no smoothing (all new value)
-    // smoothing = 0.9 means heavy smoothing (mostly old value)
-    float alpha = 1.0f - config.sticks.mouse_smoothing;
-    *smoothed_x = alpha * target_x + (1.0f - alpha) * (*smoothed_x);
-    *smoothed_y = alpha * target_y + (1.0f - alpha) * (*smoothed_y);
+void on_gip_input(void *user, const GipMessage *msg) {
+    Controller *c = (Controller *)user;
     
-    // Use smoothed values for movement
-    float norm_x = *smoothed_x;
-    float norm_y = *smoothed_y;
-    
-    // Apply exponential curve for better control
-    float sign_x = (norm_x >= 0) ? 1.0f : -1.0f;
-    float sign_y = (norm_y >= 0) ? 1.0f : -1.0f;
-    
-    float curved_x = sign_x * powf(fabsf(norm_x), config.sticks.mouse_curve);
-    float curved_y = sign_y * powf(fabsf(norm_y), config.sticks.mouse_curve);
+    // The input report is read in place, header included
+    if (!msg->packet || msg->header_length != sizeof(GipHeader) ||
+        msg->length < sizeof(GipInputPacket) - sizeof(GipHeader)) {
+        c->decoder.stats.malformed++;
+        return;
+    }
+    // Hand a copy of the snapshot to the injector; the receive buffer is
+    // reused as soon as this returns
+    InputEvent event = {
+        .type = INPUT_EVENT_PACKET,
+        .controller = (uint8_t)(c - controllers),
+        .complete_ns = msg->timestamp_ns,
+        .start_ns = c->packet_start_ns,
+        .decoded_ns = monotonic_ns(),
+    };
+    memcpy(&event.input, msg->packet, sizeof(GipInputPacket));
+    deliver_event(&event);
+}
+
+// Commands without an entry are counted as unhandled and otherwise ignored
+// (acks are sent regardless)
+static const GipDispatchTable gip_handlers = {
+    [GIP_CMD_ANNOUNCE]     = on_gip_announce,
+    [GIP_CMD_STATUS]       = on_gip_status,
+    [GIP_CMD_IDENTIFY]     = on_gip_identify,
+    [GIP_CMD_GUIDE_BUTTON] = on_gip_guide,
+    [GIP_CMD_SERIAL_NUM]   = on_gip_serial,
+    [GIP_CMD_INPUT]        = on_gip_input,
+};
+
+// Called for every packet the async engines (or a replay) deliver, in
+// arrival order; user is the Controller the packet came from
+void handle_packet(void *user, const uint8_t *data, int length, uint64_t timestamp_ns) {
+    Controller *c = (Controller *)user;
+    c->packet_start_ns = monotonic_ns();
+    
+    if (c->capturing) {
+        capture_writer_write(&c->capture, timestamp_ns, data, length);
+    }
     
-    // Scale by sensitivity
-    float dx = curved_x * config.sticks.mouse_sensitivity * 15.0f;
-    float dy = curved_y * config.sticks.mouse_sensitivity * 15.0f;
+    gip_decode(&c->decoder, data, length, timestamp_ns);
     
-    // Accumulate deltas (sent in main loop)
-    input_state.mouse_dx += dx;
-    input_state.mouse_dy += dy;
+    // The handshake watches every packet (after the decoder has acked it)
+    if (length >= (int)sizeof(GipHeader)) {
+        unsigned actions = gip_handshake_packet(&c->handshake, (const GipHeader *)data,
+                                                timestamp_ns);
+        if (actions) {
+            run_handshake_actions(c, actions);
+        }
+    }
 }
 
-void process_sticks(int16_t left_x, int16_t left_y, int16_t right_x, int16_t right_y) {
-    // Apply deadzones
-    apply_deadzone(&left_x, &left_y, config.sticks.deadzone);
-    apply_deadzone(&right_x, &right_y, config.sticks.deadzone);
-    
-    // Process left stick
-    switch (config.sticks.left_stick_mode) {
-        case STICK_MODE_WASD:
-            process_stick_as_keys(left_x, left_y, 
-                                 config.sticks.left_up, config.sticks.left_down,
-                                 config.sticks.left_left, config.sticks.left_right);
-            break;
-        case STICK_MODE_ARROWS:
-            process_stick_as_keys(left_x, left_y, 0x7E, 0x7D, 0x7B, 0x7C);
-            break;
-        case STICK_MODE_MOUSE:
-            process_stick_as_mouse(left_x, left_y, 
-                                  &input_state.smoothed_left_x, 
-                                  &input_state.smoothed_left_y);
-            break;
-        case STICK_MODE_DISABLED:
-        default:
-            break;
+void print_gip_stats(void) {
+    for (int i = 0; i < controller_count; i++) {
+        const GipStats *st = &controllers[i].decoder.stats;
+        if (st->packets == 0) {
+            continue;
+        }
+        const UsbOutputQueue *out = &controllers[i].output;
+        printf("📊 Controller %d: %lu packets, %lu dropped (sequence gaps), %lu duplicates, "
+               "%lu malformed, %lu unhandled, %lu acks sent, %lu reassembled\n",
+               controllers[i].number, st->packets, st->dropped, st->duplicates,
+               st->malformed, st->unhandled, st->acks, st->reassembled);
+        if (out->sent || out->dropped || out->failed) {
+            printf("📤 Controller %d: %lu packets sent, %lu merged, %lu dropped (queue full), "
+                   "%lu failed\n", controllers[i].number, out->sent, out->merged,
+                   out->dropped, out->failed);
+        }
+        const StickKeyStats *keys = &controllers[i].mapper.stick_stats;
+        if (keys->key_events || keys->plain_events) {
+            uint64_t plain = keys->plain_events > keys->key_events ? keys->plain_events
+                                                                     : keys->key_events;
+            printf("🕹️  Controller %d: %lu stick key events sent, %lu redundant ones suppressed "
+                   "(%lu snapbacks)\n", controllers[i].number, keys->key_events,
+                   plain - keys->key_events, keys->snapbacks);
+        }
     }
-    
-    // Process right stick
-    switch (config.sticks.right_stick_mode) {
-        case STICK_MODE_WASD:
-            process_stick_as_keys(right_x, right_y, 
-                                 config.sticks.left_up, config.sticks.left_down,
-                                 config.sticks.left_left, config.sticks.left_right);
-            break;
-        case STICK_MODE_ARROWS:
-            process_stick_as_keys(right_x, right_y, 0x7E, 0x7D, 0x7B, 0x7C);
-            break;
-        case STICK_MODE_MOUSE:
-            process_stick_as_mouse(right_x, right_y, 
-                                  &input_state.smoothed_right_x, 
-                                  &input_state.smoothed_right_y);
-            break;
-        case STICK_MODE_DISABLED:
-        default:
-            break;
+}
+
+// Set up the next controller slot: its own mapper, event batching into the
+// shared sink, and capture file. The mapping of its config file (if any) is
+// applied by the injector once the controller is attached.
+// Returns NULL when all slots are taken or the capture can't be created.
+Controller *add_controller(void) {
+    if (controller_count == MAX_CONTROLLERS) {
+        return NULL;
     }
-    
-    // Always send accumulated mouse movement if any exists (no minimum threshold)
-    if (input_state.mouse_dx != 0.0f || input_state.mouse_dy != 0.0f) {
-        send_mouse_movement(input_state.mouse_dx, input_state.mouse_dy);
-        input_state.mouse_dx = 0.0f;
-        input_state.mouse_dy = 0.0f;
+    Controller *c = &controllers[controller_count];
+    memset(c, 0, sizeof(*c));
+    c->number = controller_count + 1;
+    c->active = true;
+    
+    c->profile = -1;
+    if (default_count > 0) {
+        c->profile = default_configs[controller_count < default_count ? controller_count
+                                                                      : default_count - 1];
+    }
+    c->following = c->profile;
+    atomic_init(&c->selected_profile, -1);
+    batch_sink_init(&c->batch, &shared_sink.base);
+    mapper_init(&c->mapper, &compiled, &c->batch.base);
+    gip_decoder_init(&c->decoder, gip_handlers, gip_send, c);
+    c->status = -1;
+    
+    if (capture_path) {
+        // Controller 1 writes FILE, the others FILE.2, FILE.3, ...
+        char path[1024];
+        if (c->number == 1) {
+            snprintf(path, sizeof(path), "%s", capture_path);
+        } else {
+            snprintf(path, sizeof(path), "%s.%d", capture_path, c->number);
+        }
+        if (capture_writer_open(&c->capture, path) < 0) {
+            console_log(&log_queue, "❌ Could not create capture %s\n", path);
+            return NULL;
+        }
+        c->capturing = true;
+        console_log(&log_queue, "📼 Capturing controller %d to %s\n", c->number, path);
     }
     
-    // Store current positions for continuous movement generation
-    input_state.current_left_stick_x = left_x;
-    input_state.current_left_stick_y = left_y;
-    input_state.current_right_stick_x = right_x;
-    input_state.current_right_stick_y = right_y;
-    
-    input_state.prev_left_stick_x = left_x;
-    input_state.prev_left_stick_y = left_y;
-    input_state.prev_right_stick_x = right_x;
-    input_state.prev_right_stick_y = right_y;
+    controller_count++;
+    return c;
 }
 
-// Generate continuous mouse movement from currently held stick positions
-// This is called every frame, even when no new USB packet arrives
-void generate_continuous_movement() {
-    // Use the last known stick positions to generate movement
-    int16_t left_x = input_state.current_left_stick_x;
-    int16_t left_y = input_state.current_left_stick_y;
-    int16_t right_x = input_state.current_right_stick_x;
-    int16_t right_y = input_state.current_right_stick_y;
-    
-    // Apply deadzones
-    apply_deadzone(&left_x, &left_y, config.sticks.deadzone);
-    apply_deadzone(&right_x, &right_y, config.sticks.deadzone);
-    
-    // Generate mouse movement if sticks are in mouse mode
-    if (config.sticks.left_stick_mode == STICK_MODE_MOUSE) {
-        process_stick_as_mouse(left_x, left_y, 
-                              &input_state.smoothed_left_x, 
-                              &input_state.smoothed_left_y);
+// Controller went away: stop reading it and have the injector release
+// everything it was holding
+void deactivate_controller(Controller *c) {
+    c->active = false;
+    send_controller_event(c, INPUT_EVENT_DISCONNECTED);
+}
+
+// Pick the slot for a controller that just arrived: the one it had before
+// if it went back into the same port, else any unplugged slot, else a new
+// one. Returns NULL if the controller is already open or no slot is left.
+Controller *slot_for_device(libusb_device *device) {
+    uint8_t bus = libusb_get_bus_number(device);
+    uint8_t port = libusb_get_port_number(device);
+    Controller *same_port = NULL;
+    Controller *unplugged = NULL;
+    
+    for (int i = 0; i < controller_count; i++) {
+        Controller *c = &controllers[i];
+        if (c->device == device) {
+            return NULL;
+        }
+        if (!c->handle) {
+            if (!same_port && c->bus == bus && c->port == port) {
+                same_port = c;
+            } else if (!unplugged) {
+                unplugged = c;
+            }
+        }
     }
-    
-    if (config.sticks.right_stick_mode == STICK_MODE_MOUSE) {
-        process_stick_as_mouse(right_x, right_y, 
-                              &input_state.smoothed_right_x, 
-                              &input_state.smoothed_right_y);
+    if (same_port) {
+        return same_port;
+    }
+    if (unplugged) {
+        return unplugged;
     }
     
-    // Send accumulated mouse movement
-    if (input_state.mouse_dx != 0.0f || input_state.mouse_dy != 0.0f) {
-        send_mouse_movement(input_state.mouse_dx, input_state.mouse_dy);
-        input_state.mouse_dx = 0.0f;
-        input_state.mouse_dy = 0.0f;
+    Controller *c = add_controller();
+    if (c) {
+        c->active = false;
     }
+    return c;
 }
 
-// ============================================================================
-// GIP Protocol Functions (from phase3)
-// ============================================================================
-
-void signal_handler(int sig) {
-    (void)sig;
-    running = 0;
-    printf("\nShutting down...\n");
+// Transfers that libusb never gives back can't be freed; they are left to
+// it rather than risk a callback writing into freed memory
+void stop_transfers(Controller *c, libusb_context *ctx) {
+    int leaked = usb_input_stop(&c->engine, ctx) + usb_output_stop(&c->output, ctx);
+    if (leaked) {
+        console_log(&log_queue, "⚠️  Controller %d: %d USB transfer%s never came back from "
+                    "cancellation, leaving %s to libusb\n", c->number, leaked,
+                    leaked == 1 ? "" : "s", leaked == 1 ? "it" : "them");
+    }
 }
 
-int send_ack(libusb_device_handle *handle, uint8_t out_endpoint, uint8_t sequence) {
-    uint8_t ack_packet[] = {
-        GIP_CMD_ACKNOWLEDGE, 0x20, sequence, 0x09,
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
-    };
+// Claim a controller that was just plugged in (or was already there at
+// startup), start reading and kick off the handshake; incoming packets
+// drive it from there. A replugged controller keeps its slot, mapping and
+// capture file.
+void connect_controller(libusb_context *ctx, HotplugMonitor *hotplug, libusb_device *device) {
+    uint64_t arrived_ns = monotonic_ns();
+    Controller *c = slot_for_device(device);
+    if (!c) {
+        return;
+    }
     
-    int transferred;
-    int result = libusb_interrupt_transfer(handle, out_endpoint, ack_packet,
-                                          sizeof(ack_packet), &transferred, 1000);
+    int result = controller_open(c, device, &log_queue);
+    if (result < 0) {
+        // Right after arrival the OS may still be setting the device up
+        if (result != LIBUSB_ERROR_ACCESS && result != LIBUSB_ERROR_NOT_SUPPORTED) {
+            hotplug_rescan_after(hotplug, HOTPLUG_RESCAN_NS);
+        }
+        return;
+    }
     
-    if (result == 0 && config.console_output_enabled) {
-        printf("  → Sent ACK (seq=%d)\n", sequence);
+    // Keep several reads queued so packets are collected at the
+    // controller's native rate. Reads go out before power-on so the
+    // controller's first packets are never missed.
+    result = usb_input_start(&c->engine, c->handle, c->in_endpoint, config.usb_transfers);
+    if (result == 0) {
+        result = usb_output_start(&c->output, c->handle, c->out_endpoint);
+    }
+    if (result < 0) {
+        console_log(&log_queue, "❌ Controller %d: failed to start transfers: %s\n",
+                    c->number, libusb_error_name(result));
+        stop_transfers(c, ctx);
+        controller_close(c);
+        hotplug_rescan_after(hotplug, HOTPLUG_RESCAN_NS);
+        return;
+    }
+    c->active = true;
+    send_controller_event(c, INPUT_EVENT_CONNECTED);
+    
+    console_log(&log_queue, "%s Controller %d %s\n", c->disconnected_ns ? "🔌" : "🎮", c->number,
+                c->disconnected_ns ? "reconnected" : "connected");
+    gip_decoder_reset(&c->decoder);
+    run_handshake_actions(c, gip_handshake_start(&c->handshake, arrived_ns, monotonic_ns()));
+}
+
+// Controller unplugged or its input failed: release everything it holds,
+// stop its transfers and close it. The slot waits for it to come back.
+void disconnect_controller(Controller *c, libusb_context *ctx) {
+    if (!c->handle) {
+        return;
+    }
+    deactivate_controller(c);
+    stop_transfers(c, ctx);
+    controller_close(c);
+    c->disconnected_ns = monotonic_ns();
+}
+
+void apply_hotplug_events(libusb_context *ctx, HotplugMonitor *hotplug) {
+    HotplugEvent event;
+    while (hotplug_next(hotplug, &event)) {
+        if (event.type == HOTPLUG_ARRIVED) {
+            connect_controller(ctx, hotplug, event.device);
+        } else {
+            for (int i = 0; i < controller_count; i++) {
+                Controller *c = &controllers[i];
+                if (c->device == event.device) {
+                    console_log(&log_queue, "❌ Controller %d disconnected!\n", c->number);
+                    disconnect_controller(c, ctx);
+                }
+            }
+        }
+        libusb_unref_device(event.device);
     }
-    return (result == 0) ? 0 : -1;
 }
 
-int initialize_controller(libusb_device_handle *handle, uint8_t in_endpoint, 
-                         uint8_t out_endpoint) {
-    uint8_t buffer[64];
-    int transferred;
+void input_loop(libusb_context *ctx, HotplugMonitor *hotplug) {
     int result;
     
+    console_log(&log_queue, "=== Xbox Controller Simulator Active ===\n");
+    console_log(&log_queue, "Controller input is now being translated to keyboard/mouse\n");
+    console_log(&log_queue, "Controllers can be plugged in and unplugged at any time\n");
     if (config.console_output_enabled) {
-        printf("\n=== Initializing Controller ===\n");
-        printf("Performing GIP handshake...\n\n");
+        console_log(&log_queue, "Console output: ENABLED (see input below)\n");
+    } else {
+        console_log(&log_queue, "Console output: DISABLED\n");
     }
+    console_log(&log_queue, "Press Ctrl+C to exit\n\n");
+    
+    // One libusb event loop serves every controller and delivers the
+    // hot-plug notifications too. Translation and the mouse ticks run on
+    // the injector thread; this loop only reads, decodes and answers the
+    // controllers, so it wakes up regularly just for the handshake timers
+    // and rumble commands, and soon when hand-off events are backlogged.
+    bool waiting = false;
     
-    for (int attempt = 0; attempt < 5; attempt++) {
-        result = libusb_interrupt_transfer(handle, in_endpoint, buffer,
-                                          sizeof(buffer), &transferred, 2000);
+    while (running) {
+        apply_hotplug_events(ctx, hotplug);
         
-        if (result == 0 && transferred >= (int)sizeof(GipHeader)) {
-            GipHeader *header = (GipHeader *)buffer;
-            
-            if (config.console_output_enabled) {
-                printf("  Received: %s (0x%02x), seq=%d\n",
-                       gip_command_name(header->command), header->command, header->sequence);
+        int active = 0;
+        for (int i = 0; i < controller_count; i++) {
+            active += controllers[i].active;
+        }
+        if (active == 0 && !waiting) {
+            console_log(&log_queue, "⏳ Waiting for a controller (make sure it's plugged in and you're running with sudo)\n");
+        }
+        waiting = (active == 0);
+        
+        long timeout_us = !active ? 100000 : input_ring_flush(input_ring) ? 5000 : 200;
+        result = usb_wait_events(ctx, timeout_us);
+        if (result < 0) {
+            console_log(&log_queue, "❌ USB event handling failed: %s\n", libusb_error_name(result));
+            break;
+        }
+        
+        for (int i = 0; i < controller_count; i++) {
+            Controller *c = &controllers[i];
+            if (!c->active) {
+                continue;
+            }
+            result = usb_input_drain(&c->engine, handle_packet, c);
+            if (result == LIBUSB_ERROR_PIPE) {
+                console_log(&log_queue, "⚠️  Controller %d: endpoint stalled, clearing halt\n", c->number);
+                result = usb_input_clear_stall(&c->engine, ctx);
+                if (result < 0) {
+                    console_log(&log_queue, "❌ Controller %d: could not recover: %s\n",
+                                c->number, libusb_error_name(result));
+                    disconnect_controller(c, ctx);
+                    hotplug_rescan_after(hotplug, HOTPLUG_RESCAN_NS);
+                }
+            } else if (result == LIBUSB_ERROR_NO_DEVICE) {
+                console_log(&log_queue, "❌ Controller %d disconnected!\n", c->number);
+                disconnect_controller(c, ctx);
+            } else if (result < 0) {
+                // Still plugged in but unusable: reopen it from scratch
+                console_log(&log_queue, "❌ Controller %d: input transfer failed: %s\n",
+                            c->number, libusb_error_name(result));
+                disconnect_controller(c, ctx);
+                hotplug_rescan_after(hotplug, HOTPLUG_RESCAN_NS);
             }
             
-            if (header->command == GIP_CMD_ANNOUNCE) {
-                send_ack(handle, out_endpoint, header->sequence);
+            // Handshake fallback timers (repeat power-on if no input yet)
+            if (c->active) {
+                unsigned actions = gip_handshake_timer(&c->handshake, monotonic_ns());
+                if (actions) {
+                    run_handshake_actions(c, actions);
+                }
             }
-        } else if (result == LIBUSB_ERROR_TIMEOUT) {
-            break;
         }
+        
+        check_rumble_requests();
     }
     
-    if (config.console_output_enabled) {
-        printf("\n✅ Initialization complete!\n");
-        printf("Sending POWER ON command...\n");
+    for (int i = 0; i < controller_count; i++) {
+        stop_transfers(&controllers[i], ctx);
+    }
+    // Whatever is still backlogged goes to the injector before it stops
+    while (!input_ring_flush(input_ring)) {
+        sleep_until_ns(monotonic_ns() + 100000);
     }
+    console_log(&log_queue, "\n");
+}
+
+// Feed capture files through the same path as live USB packets, one virtual
+// controller per file. Packets from all files are merged in capture-time
+// order, and the output tick follows that clock, so a replay produces the
+// same events whether it runs at original speed or as fast as possible.
+int replay_loop(const char *const *paths, int count, bool fast, double start_sec) {
+    static CaptureReader readers[MAX_CONTROLLERS];
+    size_t next[MAX_CONTROLLERS];
+    size_t total = 0;
+    
+    for (int i = 0; i < count; i++) {
+        Controller *c = NULL;
+        bool opened = capture_reader_open(&readers[i], paths[i]) == 0;
+        if (!opened) {
+            console_log(&log_queue, "❌ Could not open capture %s\n", paths[i]);
+        } else if (!(c = add_controller())) {
+            console_log(&log_queue, "❌ No free controller slot for capture %s\n", paths[i]);
+        }
+        if (!c) {
+            for (int j = 0; j < i + opened; j++) {
+                capture_reader_close(&readers[j]);
+            }
+            return -1;
+        }
+        send_controller_event(c, INPUT_EVENT_CONNECTED);
+        next[i] = capture_reader_seek(&readers[i], (uint64_t)(start_sec * NS_PER_SEC));
+        total += readers[i].count - next[i];
+        console_log(&log_queue, "=== Replaying %s as controller %d ===\n", paths[i], c->number);
+    }
+    console_log(&log_queue, "%zu packets, %s\n", total, fast ? "as fast as possible" : "original timing");
+    console_log(&log_queue, "Press Ctrl+C to stop\n\n");
     
-    uint8_t power_on[] = {GIP_CMD_POWER, 0x20, 0x00, 0x01, 0x00};
-    result = libusb_interrupt_transfer(handle, out_endpoint, power_on,
-                                      sizeof(power_on), &transferred, 1000);
+    TickScheduler ticks;
+    bool started = false;
+    uint64_t capture_start = 0;
+    uint64_t wall_start = monotonic_ns();
+    size_t replayed = 0;
     
-    if (result == 0 && config.console_output_enabled) {
-        printf("✅ Controller powered on!\n\n");
+    while (running) {
+        // Earliest pending packet across all captures
+        int source = -1;
+        uint64_t timestamp = 0;
+        const uint8_t *data = NULL;
+        uint16_t length = 0;
+        for (int i = 0; i < count; i++) {
+            if (next[i] >= readers[i].count) {
+                continue;
+            }
+            uint64_t ts;
+            const uint8_t *d;
+            uint16_t len;
+            capture_reader_get(&readers[i], next[i], &ts, &d, &len);
+            if (source < 0 || ts < timestamp) {
+                source = i;
+                timestamp = ts;
+                data = d;
+                length = len;
+            }
+        }
+        if (source < 0) {
+            break;
+        }
+        next[source]++;
+        
+        if (!started) {
+            capture_start = timestamp;
+            tick_scheduler_init(&ticks, config.output_rate_hz, timestamp);
+            started = true;
+        }
+        
+        // Run every tick and timed action that falls before this packet on
+        // the capture clock
+        while (running) {
+            uint64_t due = ticks.next_ns;
+            for (int i = 0; i < controller_count; i++) {
+                uint64_t deadline = mapper_next_deadline(&controllers[i].mapper);
+                if (deadline < due) {
+                    due = deadline;
+                }
+            }
+            if (due > timestamp) {
+                break;
+            }
+            if (!fast) {
+                sleep_until_ns(wall_start + (due - capture_start));
+            }
+            uint64_t dt;
+            bool tick = tick_scheduler_due(&ticks, due, &dt);
+            for (int i = 0; i < controller_count; i++) {
+                mapper_advance(&controllers[i].mapper, due);
+                if (tick) {
+                    output_tick(&controllers[i].mapper, dt);
+                }
+            }
+        }
+        
+        if (!fast) {
+            sleep_until_ns(wall_start + (timestamp - capture_start));
+        }
+        // Latency is measured from when the packet is handed over
+        replay_clock_ns = timestamp;
+        handle_packet(&controllers[source], data, length, monotonic_ns());
+        replayed++;
+        check_latency_dump();
+        check_config_reload();
     }
     
-    usleep(500000);
+    uint64_t elapsed = monotonic_ns() - wall_start;
+    console_log(&log_queue, "\n📼 Replayed %zu packets from %d controller%s in %.3f s "
+                "(%.0f packets/sec, %.0f ns/packet)\n\n",
+                replayed, count, count == 1 ? "" : "s", (double)elapsed / NS_PER_SEC,
+                elapsed ? (double)replayed * NS_PER_SEC / elapsed : 0.0,
+                replayed ? (double)elapsed / replayed : 0.0);
+    
+    for (int i = 0; i < count; i++) {
+        capture_reader_close(&readers[i]);
+    }
     return 0;
 }
 
-void input_loop(libusb_device_handle *handle, uint8_t in_endpoint) {
-    uint8_t buffer[64];
-    int transferred;
+// Claim every controller that is plugged in now or later, run the GIP
+// handshake on each and translate their input until shutdown.
+// Returns 0 on a clean stop, 1 on setup failure.
+int run_usb_controllers(void) {
+    libusb_context *ctx = NULL;
     int result;
-    int input_count = 0;
     
-    printf("=== Xbox Controller Simulator Active ===\n");
-    printf("Controller input is now being translated to keyboard/mouse\n");
-    if (config.console_output_enabled) {
-        printf("Console output: ENABLED (see input below)\n");
+    // Initialize libusb
+    result = libusb_init(&ctx);
+    if (result < 0) {
+        console_log(&log_queue, "❌ Failed to initialize libusb: %s\n", libusb_error_name(result));
+        return 1;
+    }
+    
+    // Translation runs on its own thread from here on
+    input_ring_init(&handoff_ring);
+    input_ring = &handoff_ring;
+    atomic_store(&injector_stop, false);
+    pthread_t injector;
+    if (pthread_create(&injector, NULL, injector_thread, &handoff_ring) != 0) {
+        console_log(&log_queue, "❌ Failed to start the injector thread\n");
+        input_ring = NULL;
+        libusb_exit(ctx);
+        return 1;
+    }
+    
+    // Controllers already connected arrive through the same path as ones
+    // plugged in later
+    console_log(&log_queue, "Looking for Xbox controllers...\n");
+    HotplugMonitor hotplug;
+    hotplug_start(&hotplug, ctx);
+    if (!hotplug.registered) {
+        console_log(&log_queue, "⚠️  No hot-plug notifications available, checking for controllers every %d ms\n",
+                    (int)(HOTPLUG_RESCAN_NS / NS_PER_MS));
+    }
+    
+    rumble_fd = rumble_socket_open(rumble_path);
+    if (rumble_fd >= 0) {
+        console_log(&log_queue, "📳 Rumble commands accepted on %s\n", rumble_path);
     } else {
-        printf("Console output: DISABLED\n");
+        console_log(&log_queue, "⚠️  Could not create rumble socket %s\n", rumble_path);
     }
-    printf("Press Ctrl+C to exit\n\n");
     
-    while (running) {
-        result = libusb_interrupt_transfer(handle, in_endpoint, buffer,
-                                          sizeof(buffer), &transferred, 10);  // 10ms timeout for smoother mouse
-        
-        if (result == 0 && transferred >= (int)sizeof(GipHeader)) {
-            GipHeader *header = (GipHeader *)buffer;
-            
-            if (header->command == GIP_CMD_INPUT && 
-                transferred >= (int)sizeof(GipInputPacket)) {
-                GipInputPacket *input = (GipInputPacket *)buffer;
-                input_count++;
-                
-                // Process and inject input events (updates stick positions)
-                process_buttons(input->buttons);
-                process_triggers(input->left_trigger, input->right_trigger);
-                process_sticks(input->left_stick_x, input->left_stick_y,
-                             input->right_stick_x, input->right_stick_y);
-                
-                // Console output (if enabled)
-                if (config.console_output_enabled) {
-                    printf("\r[%04d] ", input_count);
-                    printf("BTN: ");
-                    if (input->buttons) {
-                        print_buttons(input->buttons);
-                    } else {
-                        printf("none ");
-                    }
-                    printf("%-40s", "");
-                    printf("\r[%04d] BTN: ", input_count);
-                    print_buttons(input->buttons);
-                    printf("| LT:%3d RT:%3d ", input->left_trigger, input->right_trigger);
-                    printf("| LS:(%6d,%6d) RS:(%6d,%6d)  ",
-                           input->left_stick_x, input->left_stick_y,
-                           input->right_stick_x, input->right_stick_y);
-                    fflush(stdout);
-                }
-                
-            } else if (header->command == GIP_CMD_GUIDE_BUTTON && 
-                      config.console_output_enabled) {
-                printf("\n🎮 GUIDE BUTTON PRESSED\n");
-            }
-            
-        } else if (result == LIBUSB_ERROR_TIMEOUT) {
-            // Timeout: No new packet, but generate movement from held stick positions
-            generate_continuous_movement();
-            
-        } else if (result == LIBUSB_ERROR_NO_DEVICE) {
-            printf("\n❌ Controller disconnected!\n");
-            break;
+    // Profiles can follow the frontmost application
+    static FileAppProvider file_provider;
+#ifdef __APPLE__
+    static AppProvider window_provider;
+    window_provider = cg_app_provider_make();
+    AppProvider *provider = &window_provider;
+#else
+    AppProvider *provider = NULL;
+#endif
+    if (frontmost_path) {
+        file_app_provider_init(&file_provider, frontmost_path);
+        provider = &file_provider.base;
+    }
+    if (provider && config_count > 0) {
+        frontmost_running = frontmost_watch_start(&frontmost, provider);
+        if (!frontmost_running) {
+            console_log(&log_queue, "⚠️  Could not watch the frontmost application\n");
         }
     }
     
-    printf("\n\n");
+    // Run simulator
+    input_loop(ctx, &hotplug);
+    
+    atomic_store(&injector_stop, true);
+    input_ring_wake(&handoff_ring);
+    pthread_join(injector, NULL);
+    if (handoff_ring.merged || handoff_ring.stalls) {
+        console_log(&log_queue, "🔀 Hand-off: %lu snapshots merged under backpressure, %lu reader stalls\n",
+                    handoff_ring.merged, handoff_ring.stalls);
+    }
+    input_ring = NULL;
+    input_ring_destroy(&handoff_ring);
+    
+    console_log(&log_queue, "Cleaning up...\n");
+    if (frontmost_running) {
+        frontmost_watch_stop(&frontmost);
+        frontmost_running = false;
+    }
+    if (rumble_fd >= 0) {
+        rumble_socket_close(rumble_fd, rumble_path);
+        rumble_fd = -1;
+    }
+    hotplug_stop(&hotplug);
+    for (int i = 0; i < controller_count; i++) {
+        controller_close(&controllers[i]);
+    }
+    libusb_exit(ctx);
+    return 0;
 }
 
 // ============================================================================
 // Main
 // ============================================================================
 
-int main() {
-    libusb_context *ctx = NULL;
-    libusb_device_handle *handle = NULL;
+void print_usage(const char *program) {
+    printf("Usage: sudo %s [options]\n\n", program);
+    printf("Options:\n");
+    printf("  --config FILE           Load settings from FILE and reload it when it changes\n");
+    printf("                          (repeat to give each controller its own file)\n");
+    printf("  --profile FILE          Also load FILE as a profile that is only used when\n");
+    printf("                          picked over the socket or by its apps list\n");
+    printf("  --frontmost-file FILE   Read the frontmost application's name from FILE\n");
+    printf("                          (instead of the macOS window list)\n");
+    printf("  --headless              Translate input but don't inject any events\n");
+    printf("  --record-events FILE    Also log every output event (timestamped) to FILE\n");
+    printf("  --gamepad               Pass input through to a virtual gamepad instead of\n");
+    printf("                          keyboard/mouse (Linux uhid)\n");
+    printf("  --capture FILE          Save every raw GIP packet to FILE\n");
+    printf("                          (controller 2 goes to FILE.2, and so on)\n");
+    printf("  --replay FILE           Use a capture instead of a controller\n");
+    printf("                          (repeat to replay several controllers at once)\n");
+    printf("  --replay-fast           Replay as fast as possible and report packets/sec\n");
+    printf("                          (console output is turned off)\n");
+    printf("  --replay-from SECONDS   Start the replay this far into the capture\n");
+    printf("  --rumble-socket PATH    Accept rumble commands on this UNIX socket\n");
+    printf("                          (default %s)\n", RUMBLE_SOCKET_DEFAULT);
+    printf("  --latency               Print latency histograms at exit\n");
+    printf("                          (send SIGUSR1 to print them at any time)\n");
+    printf("  --help                  Show this help\n");
+}
+
+int main(int argc, char *argv[]) {
     int result;
+    bool headless = false;
+    const char *record_path = NULL;
+    const char *replay_paths[MAX_CONTROLLERS];
+    int replay_count = 0;
+    bool replay_fast = false;
+    double replay_from = 0.0;
+    bool latency_report = false;
+    
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--config") == 0 && i + 1 < argc && config_count < MAX_CONFIGS &&
+            default_count < MAX_CONTROLLERS) {
+            default_configs[default_count++] = config_count;
+            config_paths[config_count++] = argv[++i];
+        } else if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc &&
+                   config_count < MAX_CONFIGS) {
+            config_paths[config_count++] = argv[++i];
+        } else if (strcmp(argv[i], "--frontmost-file") == 0 && i + 1 < argc) {
+            frontmost_path = argv[++i];
+        } else if (strcmp(argv[i], "--headless") == 0) {
+            headless = true;
+        } else if (strcmp(argv[i], "--gamepad") == 0) {
+            gamepad_passthrough = true;
+        } else if (strcmp(argv[i], "--record-events") == 0 && i + 1 < argc) {
+            record_path = argv[++i];
+        } else if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc) {
+            capture_path = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc &&
+                   replay_count < MAX_CONTROLLERS) {
+            replay_paths[replay_count++] = argv[++i];
+        } else if (strcmp(argv[i], "--replay-fast") == 0) {
+            replay_fast = true;
+        } else if (strcmp(argv[i], "--replay-from") == 0 && i + 1 < argc) {
+            replay_from = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--rumble-socket") == 0 && i + 1 < argc) {
+            rumble_path = argv[++i];
+        } else if (strcmp(argv[i], "--latency") == 0) {
+            latency_report = true;
+        } else if (strcmp(argv[i], "--help") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        } else {
+            printf("❌ Unknown option: %s\n\n", argv[i]);
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
     
+    console_log_init(&log_queue);
     signal(SIGINT, signal_handler);
     signal(SIGTERM, signal_handler);
+    signal(SIGUSR1, latency_signal_handler);
     
     printf("Xbox Controller to Keyboard/Mouse Simulator\n");
     printf("============================================\n\n");
     
-    // Load configuration
-    config = get_default_mapping();
+    // Load configuration: built-in defaults, then the config file on top.
+    // Startup-only settings (USB, output rate, console) come from the first
+    // --config file. A profile is named after its file, without extension.
+    ControllerMapping defaults = get_default_mapping();
+    static ControllerMapping profiles[MAX_CONFIGS];
+    for (int i = 0; i < config_count; i++) {
+        profiles[i] = defaults;
+        if (!config_file_load(config_paths[i], &profiles[i], NULL)) {
+            return 1;
+        }
+        const char *base = strrchr(config_paths[i], '/');
+        snprintf(config_names[i], sizeof(config_names[i]), "%s", base ? base + 1 : config_paths[i]);
+        char *extension = strrchr(config_names[i], '.');
+        if (extension && extension != config_names[i]) {
+            *extension = '\0';
+        }
+    }
+    config = default_count > 0 ? profiles[default_configs[0]] : defaults;
+    if (replay_count > 0 && replay_fast) {
+        config.console_output_enabled = false;
+    }
+    
+    // Choose where translated events go
+    static OutputSink null_sink;
+    static RecordingSink recording_sink;
+    static FanoutSink fanout_sink;
+    OutputSink *sink;
+    
+    null_sink = null_sink_make();
+#ifdef __APPLE__
+    static CoreGraphicsSink cg_sink;
+    cg_sink_init(&cg_sink, config.streaming_mode);
+    sink = headless ? &null_sink : &cg_sink.base;
+    if (!headless && gamepad_passthrough) {
+        printf("⚠️  macOS doesn't allow virtual gamepads, running headless\n\n");
+        sink = &null_sink;
+    }
+#elif defined(__linux__)
+    static UinputSink uinput_sink;
+    static UhidSink uhid_sink;
+    uinput_sink.fd = -1;
+    uhid_sink_init(&uhid_sink);
+    sink = &null_sink;
+    if (!headless && gamepad_passthrough) {
+        result = uhid_sink_check();
+        if (result == 0) {
+            sink = &uhid_sink.base;
+        } else {
+            printf("⚠️  Could not open %s (%s), running headless\n\n", UHID_DEVICE_PATH,
+                   strerror(-result));
+        }
+    } else if (!headless) {
+        result = uinput_sink_open(&uinput_sink);
+        if (result == 0) {
+            sink = &uinput_sink.base;
+        } else {
+            printf("⚠️  Could not create a uinput device (%s), running headless\n\n",
+                   strerror(-result));
+        }
+    }
+#else
+    if (!headless) {
+        printf("⚠️  No keyboard/mouse injection on this platform, running headless\n\n");
+    }
+    sink = &null_sink;
+#endif
+    
+    const char *output_name = sink->name;
+    if (record_path) {
+        recording_sink_init(&recording_sink);
+        fanout_sink_init(&fanout_sink);
+        fanout_sink_add(&fanout_sink, sink);
+        fanout_sink_add(&fanout_sink, &recording_sink.base);
+        sink = &fanout_sink.base;
+    }
+    
+    timed_sink_init(&timed_sink, sink);
+    shared_sink_init(&shared_sink, &timed_sink.base);
+    
+    // Mappings: one watched file per --config, or the built-in defaults
+    compile_profile(&compiled, &config);
+    for (int i = 0; i < config_count; i++) {
+        if (!config_watch_start(&config_watchers[i], config_paths[i], &defaults, &profiles[i],
+                                &log_queue)) {
+            printf("❌ Could not start watching %s\n", config_paths[i]);
+            return 1;
+        }
+    }
     
     printf("Configuration loaded:\n");
     printf("  Left stick: %s\n", 
@@ -568,101 +1291,112 @@ int main() {
            (config.sticks.deadzone / 32767.0f) * 100.0f);
     printf("  Mouse smoothing: %.2f (0.0=none, 0.9=max)\n", config.sticks.mouse_smoothing);
     printf("  Mouse sensitivity: %.1f\n", config.sticks.mouse_sensitivity);
+    printf("  Output rate: %d Hz\n", config.output_rate_hz);
     printf("  Streaming mode: %s\n", config.streaming_mode ? "ENABLED (for Moonlight/Parsec)" : "disabled (for local apps)");
+    printf("  Output: %s%s%s\n", output_name, gamepad_passthrough ? " (gamepad passthrough)" : "",
+           record_path ? " + event recording" : "");
+    for (int i = 0; i < config.layers.count; i++) {
+        printf("  Layer %s: hold ", config.layers.list[i].name);
+        print_buttons(config.layers.list[i].buttons);
+        printf("(%d setting%s)\n", config.layers.list[i].override_count,
+               config.layers.list[i].override_count == 1 ? "" : "s");
+    }
+    for (int i = 0; i < config_count; i++) {
+        bool is_default = false;
+        for (int d = 0; d < default_count; d++) {
+            is_default |= default_configs[d] == i;
+        }
+        printf("  %s: %s, profile \"%s\" (reloaded on change", is_default ? "Config file" : "Profile",
+               config_paths[i], config_names[i]);
+        if (profiles[i].profile.app_count > 0) {
+            printf("; for %s", profiles[i].profile.apps[0]);
+            for (int a = 1; a < profiles[i].profile.app_count; a++) {
+                printf(", %s", profiles[i].profile.apps[a]);
+            }
+        }
+        printf(")\n");
+    }
     printf("\n");
     
+#ifdef __APPLE__
     printf("⚠️  IMPORTANT: You may need to grant Accessibility permissions:\n");
     printf("   System Settings → Privacy & Security → Accessibility\n");
     printf("   Add Terminal (or your terminal app) to the list\n\n");
+#endif
+    fflush(stdout);
     
-    // Initialize libusb
-    result = libusb_init(&ctx);
-    if (result < 0) {
-        printf("❌ Failed to initialize libusb: %s\n", libusb_error_name(result));
+    // From here until the run ends, output goes through the renderer
+    pthread_t renderer;
+    if (pthread_create(&renderer, NULL, renderer_thread, NULL) != 0) {
+        printf("❌ Failed to start the console thread\n");
         return 1;
     }
     
-    // Find controller
-    printf("Looking for Xbox controller...\n");
-    handle = libusb_open_device_with_vid_pid(ctx, XBOX_VENDOR_ID, XBOX_PRODUCT_ID);
-    if (!handle) {
-        printf("❌ Controller not found\n");
-        printf("   Make sure it's plugged in and you're running with sudo\n");
-        libusb_exit(ctx);
-        return 1;
+    if (replay_count > 0) {
+        result = replay_loop(replay_paths, replay_count, replay_fast, replay_from) < 0 ? 1 : 0;
+    } else {
+        result = run_usb_controllers();
     }
-    printf("✅ Found controller\n");
     
-    // Detach kernel driver
-    if (libusb_kernel_driver_active(handle, 0) == 1) {
-        libusb_detach_kernel_driver(handle, 0);
-    }
+    atomic_store(&renderer_stop, true);
+    pthread_join(renderer, NULL);
     
-    // Claim interface
-    result = libusb_claim_interface(handle, 0);
-    if (result < 0) {
-        printf("❌ Failed to claim interface: %s\n", libusb_error_name(result));
-        libusb_close(handle);
-        libusb_exit(ctx);
-        return 1;
+    // Cleanup - release all keys
+    printf("Releasing all keys...\n");
+    for (int i = 0; i < controller_count; i++) {
+        mapper_release_all(&controllers[i].mapper);
     }
-    printf("✅ Claimed interface\n");
-    
-    // Get endpoints
-    struct libusb_config_descriptor *desc;
-    libusb_get_active_config_descriptor(libusb_get_device(handle), &desc);
     
-    uint8_t in_endpoint = 0;
-    uint8_t out_endpoint = 0;
-    
-    const struct libusb_interface *inter = &desc->interface[0];
-    const struct libusb_interface_descriptor *interdesc = &inter->altsetting[0];
+    for (int i = 0; i < config_count; i++) {
+        config_watch_stop(&config_watchers[i]);
+    }
     
-    for (int i = 0; i < interdesc->bNumEndpoints; i++) {
-        const struct libusb_endpoint_descriptor *ep = &interdesc->endpoint[i];
-        if ((ep->bmAttributes & 0x03) == LIBUSB_TRANSFER_TYPE_INTERRUPT) {
-            if (ep->bEndpointAddress & LIBUSB_ENDPOINT_IN) {
-                in_endpoint = ep->bEndpointAddress;
-            } else {
-                out_endpoint = ep->bEndpointAddress;
-            }
+    if (record_path) {
+        FILE *out = fopen(record_path, "w");
+        if (out) {
+            recording_sink_dump(&recording_sink, out);
+            fclose(out);
+            printf("📝 Wrote %zu events to %s\n", recording_sink.count, record_path);
+        } else {
+            printf("⚠️  Could not write %s\n", record_path);
         }
+        recording_sink_free(&recording_sink);
     }
     
-    libusb_free_config_descriptor(desc);
-    
-    if (in_endpoint == 0 || out_endpoint == 0) {
-        printf("❌ Could not find interrupt endpoints\n");
-        libusb_release_interface(handle, 0);
-        libusb_close(handle);
-        libusb_exit(ctx);
-        return 1;
+    for (int i = 0; i < controller_count; i++) {
+        Controller *c = &controllers[i];
+        if (c->capturing) {
+            printf("📼 Saved %zu packets from controller %d\n", c->capture.count, c->number);
+            capture_writer_close(&c->capture);
+        }
     }
     
-    // Initialize controller
-    initialize_controller(handle, in_endpoint, out_endpoint);
-    
-    // Run simulator
-    input_loop(handle, in_endpoint);
+    print_gip_stats();
+    if (latency_report) {
+        print_latency(stdout);
+    }
     
-    // Cleanup - release all keys
-    printf("Releasing all keys...\n");
-    for (int i = 0; i < 256; i++) {
-        if (input_state.keys[i]) {
-            send_key_event(i, false);
-        }
+#ifdef __APPLE__
+    cg_sink_close(&cg_sink);
+#elif defined(__linux__)
+    if (uinput_sink.failed) {
+        printf("⚠️  uinput: %lu of %lu frames were not accepted\n",
+               uinput_sink.failed, uinput_sink.frames);
     }
-    if (input_state.mouse_left) {
-        send_mouse_button_event(kCGMouseButtonLeft, false);
+    uinput_sink_close(&uinput_sink);
+    if (uhid_sink.create_error) {
+        printf("⚠️  uhid: could not create a gamepad (%s)\n", strerror(uhid_sink.create_error));
     }
-    if (input_state.mouse_right) {
-        send_mouse_button_event(kCGMouseButtonRight, false);
+    if (uhid_sink.failed) {
+        printf("⚠️  uhid: %lu of %lu reports were not accepted\n",
+               uhid_sink.failed, uhid_sink.reports + uhid_sink.failed);
     }
+    uhid_sink_close(&uhid_sink);
+#endif
     
-    printf("Cleaning up...\n");
-    libusb_release_interface(handle, 0);
-    libusb_close(handle);
-    libusb_exit(ctx);
+    if (result != 0) {
+        return result;
+    }
     
     printf("\n✅ Simulator stopped cleanly!\n");
     return 0;
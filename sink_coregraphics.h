@@ -0,0 +1,217 @@
+// sink_coregraphics.h
+// macOS output sink: injects keyboard/mouse events through CoreGraphics
+// Requires Accessibility permissions for the terminal running the simulator
+
+#ifndef SINK_COREGRAPHICS_H
+#define SINK_COREGRAPHICS_H
+
+#ifdef __APPLE__
+
+#include <ApplicationServices/ApplicationServices.h>
+#include "output_sink.h"
+
+// The sink keeps its own model of the cursor position instead of asking the
+// WindowServer (CGEventCreate + CGEventGetLocation) before every event. The
+// model is re-synced with the real cursor at most every CG_CURSOR_RESYNC_NS,
+// which also picks up moves made with a real mouse.
+#define CG_CURSOR_RESYNC_NS     (250 * NS_PER_MS)
+#define CG_DISPLAY_REFRESH_NS   (2000 * NS_PER_MS)
+#define CG_MAX_DISPLAYS         16
+
+typedef struct {
+    OutputSink base;
+    bool streaming_mode;   // Send relative deltas instead of absolute positions
+
+    // Cursor model
+    CGPoint cursor;
+    uint64_t last_sync_ns;
+
+    // Cached display geometry for clamping
+    CGRect displays[CG_MAX_DISPLAYS];
+    uint32_t display_count;
+    uint64_t last_display_refresh_ns;
+    volatile bool displays_dirty;
+
+    // Pooled events: created once and retyped for every post instead of a
+    // create/post/release per transition
+    CGEventRef key_event;
+    CGEventRef mouse_event;
+} CoreGraphicsSink;
+
+static inline void cg_sink_refresh_displays(CoreGraphicsSink *cg, uint64_t now) {
+    CGDirectDisplayID ids[CG_MAX_DISPLAYS];
+    uint32_t count = 0;
+    if (CGGetActiveDisplayList(CG_MAX_DISPLAYS, ids, &count) != kCGErrorSuccess) {
+        count = 0;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        cg->displays[i] = CGDisplayBounds(ids[i]);
+    }
+    cg->display_count = count;
+    cg->last_display_refresh_ns = now;
+    cg->displays_dirty = false;
+}
+
+static inline void cg_sink_display_changed(CGDirectDisplayID display,
+                                           CGDisplayChangeSummaryFlags flags, void *user) {
+    (void)display; (void)flags;
+    ((CoreGraphicsSink *)user)->displays_dirty = true;
+}
+
+// Bring the cursor model (and display cache) up to date if it is stale
+static inline void cg_sink_sync(CoreGraphicsSink *cg) {
+    uint64_t now = monotonic_ns();
+
+    if (cg->displays_dirty || now - cg->last_display_refresh_ns >= CG_DISPLAY_REFRESH_NS) {
+        cg_sink_refresh_displays(cg, now);
+    }
+
+    if (now - cg->last_sync_ns >= CG_CURSOR_RESYNC_NS) {
+        CGEventRef getPos = CGEventCreate(NULL);
+        if (getPos) {
+            cg->cursor = CGEventGetLocation(getPos);
+            CFRelease(getPos);
+        }
+        cg->last_sync_ns = now;
+    }
+}
+
+// Keep a moved cursor on screen: positions on any display are allowed,
+// anything else is clamped to the display the cursor is leaving
+static inline CGPoint cg_sink_clamp(const CoreGraphicsSink *cg, CGPoint from, CGPoint to) {
+    if (cg->display_count == 0) {
+        return to;
+    }
+    for (uint32_t i = 0; i < cg->display_count; i++) {
+        if (CGRectContainsPoint(cg->displays[i], to)) {
+            return to;
+        }
+    }
+
+    CGRect bounds = cg->displays[0];
+    for (uint32_t i = 0; i < cg->display_count; i++) {
+        if (CGRectContainsPoint(cg->displays[i], from)) {
+            bounds = cg->displays[i];
+            break;
+        }
+    }
+
+    CGFloat max_x = CGRectGetMaxX(bounds) - 1.0;
+    CGFloat max_y = CGRectGetMaxY(bounds) - 1.0;
+    if (to.x < CGRectGetMinX(bounds)) to.x = CGRectGetMinX(bounds);
+    if (to.x > max_x) to.x = max_x;
+    if (to.y < CGRectGetMinY(bounds)) to.y = CGRectGetMinY(bounds);
+    if (to.y > max_y) to.y = max_y;
+    return to;
+}
+
+static inline void cg_sink_key(OutputSink *sink, uint16_t keycode, bool pressed) {
+    CoreGraphicsSink *cg = (CoreGraphicsSink *)sink;
+    if (!cg->key_event) {
+        return;
+    }
+    CGEventSetType(cg->key_event, pressed ? kCGEventKeyDown : kCGEventKeyUp);
+    CGEventSetIntegerValueField(cg->key_event, kCGKeyboardEventKeycode, keycode);
+    CGEventPost(kCGHIDEventTap, cg->key_event);
+}
+
+// Retype the pooled mouse event and post it
+static inline void cg_sink_post_mouse(CoreGraphicsSink *cg, CGEventType type, CGPoint location,
+                                      CGMouseButton button, int64_t dx, int64_t dy) {
+    CGEventRef event = cg->mouse_event;
+    if (!event) {
+        return;
+    }
+    CGEventSetType(event, type);
+    CGEventSetLocation(event, location);
+    CGEventSetIntegerValueField(event, kCGMouseEventButtonNumber, button);
+    CGEventSetIntegerValueField(event, kCGMouseEventDeltaX, dx);
+    CGEventSetIntegerValueField(event, kCGMouseEventDeltaY, dy);
+    CGEventPost(kCGHIDEventTap, event);
+}
+
+static inline void cg_sink_mouse_button(OutputSink *sink, MouseButton button, bool pressed) {
+    CoreGraphicsSink *cg = (CoreGraphicsSink *)sink;
+    cg_sink_sync(cg);
+
+    CGEventType eventType;
+    CGMouseButton cgButton;
+    switch (button) {
+        case MOUSE_BUTTON_LEFT:
+            eventType = pressed ? kCGEventLeftMouseDown : kCGEventLeftMouseUp;
+            cgButton = kCGMouseButtonLeft;
+            break;
+        case MOUSE_BUTTON_RIGHT:
+            eventType = pressed ? kCGEventRightMouseDown : kCGEventRightMouseUp;
+            cgButton = kCGMouseButtonRight;
+            break;
+        case MOUSE_BUTTON_MIDDLE:
+            eventType = pressed ? kCGEventOtherMouseDown : kCGEventOtherMouseUp;
+            cgButton = kCGMouseButtonCenter;
+            break;
+        default:
+            return;
+    }
+
+    cg_sink_post_mouse(cg, eventType, cg->cursor, cgButton, 0, 0);
+}
+
+static inline void cg_sink_mouse_move(OutputSink *sink, float dx, float dy) {
+    CoreGraphicsSink *cg = (CoreGraphicsSink *)sink;
+
+    if (dx == 0.0f && dy == 0.0f) {
+        return;
+    }
+
+    cg_sink_sync(cg);
+
+    if (cg->streaming_mode) {
+        // Streaming mode: Use delta fields (for Moonlight, Parsec, etc.)
+        // The cursor itself stays where it is
+        cg_sink_post_mouse(cg, kCGEventMouseMoved, cg->cursor, 0, (int64_t)dx, (int64_t)dy);
+    } else {
+        // Local mode: Use absolute positioning (for native macOS apps)
+        CGPoint newPos = cg_sink_clamp(cg, cg->cursor,
+                                       CGPointMake(cg->cursor.x + dx, cg->cursor.y + dy));
+        cg_sink_post_mouse(cg, kCGEventMouseMoved, newPos, 0, 0, 0);
+        cg->cursor = newPos;
+    }
+}
+
+static inline void cg_sink_init(CoreGraphicsSink *cg, bool streaming_mode) {
+    cg->base.name = "coregraphics";
+    cg->base.key = cg_sink_key;
+    cg->base.mouse_button = cg_sink_mouse_button;
+    cg->base.mouse_move = cg_sink_mouse_move;
+    cg->base.gamepad = sink_gamepad_noop;
+    cg->base.flush = sink_flush_noop;
+    cg->streaming_mode = streaming_mode;
+
+    // Force a cursor query and display scan on the first event
+    cg->cursor = CGPointMake(0, 0);
+    cg->last_sync_ns = 0;
+    cg->display_count = 0;
+    cg->last_display_refresh_ns = 0;
+    cg->displays_dirty = true;
+    CGDisplayRegisterReconfigurationCallback(cg_sink_display_changed, cg);
+
+    cg->key_event = CGEventCreateKeyboardEvent(NULL, 0, true);
+    cg->mouse_event = CGEventCreateMouseEvent(NULL, kCGEventMouseMoved, cg->cursor,
+                                              kCGMouseButtonLeft);
+}
+
+static inline void cg_sink_close(CoreGraphicsSink *cg) {
+    CGDisplayRemoveReconfigurationCallback(cg_sink_display_changed, cg);
+    if (cg->key_event) {
+        CFRelease(cg->key_event);
+        cg->key_event = NULL;
+    }
+    if (cg->mouse_event) {
+        CFRelease(cg->mouse_event);
+        cg->mouse_event = NULL;
+    }
+}
+
+#endif // __APPLE__
+
+#endif // SINK_COREGRAPHICS_H
@@ -0,0 +1,146 @@
+// sink_uhid.h
+// Linux output sink: virtual HID gamepads created through uhid
+// Each controller gets its own gamepad, described by hid_descriptor.h and
+// created the first time that controller sends a report. A report is one
+// small write() of a UHID_INPUT2 event carrying the 12-byte GamepadReport;
+// the kernel's hid-generic driver turns it into a joystick/evdev device.
+// Needs write access to /dev/uhid (root, or a udev rule).
+//
+// Keyboard/mouse events are ignored: this sink is for gamepad passthrough.
+
+#ifndef SINK_UHID_H
+#define SINK_UHID_H
+
+#ifdef __linux__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <linux/uhid.h>
+#include "output_sink.h"
+#include "hid_descriptor.h"
+
+#define UHID_DEVICE_PATH    "/dev/uhid"
+#define UHID_DEVICE_NAME    "Xbox Controller (passthrough)"
+#define UHID_MAX_PADS       8
+#define UHID_DRAIN_EVERY    256     // Reports between reads of kernel events
+
+// Bytes of a UHID_INPUT2 event up to the end of our report; the kernel
+// doesn't need the rest of the (4 KB) struct
+#define UHID_INPUT_SIZE     (offsetof(struct uhid_event, u.input2.data) + sizeof(GamepadReport))
+
+typedef struct {
+    OutputSink base;
+    int fds[UHID_MAX_PADS];     // -1 until created, -2 if creating it failed
+
+    unsigned long reports;      // Reports written
+    unsigned long failed;       // Reports the kernel didn't take
+    int create_error;           // errno of the last failed device creation
+} UhidSink;
+
+// Open /dev/uhid and create one gamepad on it. Returns the fd or -errno.
+static inline int uhid_sink_create_pad(uint8_t pad) {
+    int fd = open(UHID_DEVICE_PATH, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+        return -errno;
+    }
+
+    struct uhid_event event;
+    memset(&event, 0, sizeof(event));
+    event.type = UHID_CREATE2;
+    snprintf((char *)event.u.create2.name, sizeof(event.u.create2.name), "%s %d",
+             UHID_DEVICE_NAME, pad + 1);
+    snprintf((char *)event.u.create2.uniq, sizeof(event.u.create2.uniq), "pad%d", pad + 1);
+    event.u.create2.rd_size = GAMEPAD_HID_DESCRIPTOR_SIZE;
+    memcpy(event.u.create2.rd_data, gamepad_hid_descriptor, GAMEPAD_HID_DESCRIPTOR_SIZE);
+    event.u.create2.bus = BUS_VIRTUAL;
+
+    if (write(fd, &event, sizeof(event)) != (ssize_t)sizeof(event)) {
+        int error = errno ? errno : EIO;
+        close(fd);
+        return -error;
+    }
+    return fd;
+}
+
+// The kernel queues start/open/close notifications for us; nothing here
+// needs them, but an unread queue overflows and gets logged
+static inline void uhid_sink_drain(int fd) {
+    struct uhid_event event;
+    while (read(fd, &event, sizeof(event)) > 0) {
+    }
+}
+
+static inline void uhid_sink_gamepad(OutputSink *sink, uint8_t pad, const GamepadReport *report) {
+    UhidSink *u = (UhidSink *)sink;
+    if (pad >= UHID_MAX_PADS || u->fds[pad] == -2) {
+        return;
+    }
+    if (u->fds[pad] == -1) {
+        int fd = uhid_sink_create_pad(pad);
+        if (fd < 0) {
+            u->fds[pad] = -2;
+            u->create_error = -fd;
+            return;
+        }
+        u->fds[pad] = fd;
+    }
+
+    struct uhid_event event;
+    event.type = UHID_INPUT2;
+    event.u.input2.size = sizeof(GamepadReport);
+    memcpy(event.u.input2.data, report, sizeof(GamepadReport));
+
+    ssize_t result;
+    do {
+        result = write(u->fds[pad], &event, UHID_INPUT_SIZE);
+    } while (result < 0 && errno == EINTR);
+
+    if (result != (ssize_t)UHID_INPUT_SIZE) {
+        u->failed++;
+    } else if (u->reports++ % UHID_DRAIN_EVERY == 0) {
+        uhid_sink_drain(u->fds[pad]);
+    }
+}
+
+static inline void uhid_sink_init(UhidSink *u) {
+    memset(u, 0, sizeof(*u));
+    u->base.name = "uhid";
+    u->base.key = null_sink_key;
+    u->base.mouse_button = null_sink_mouse_button;
+    u->base.mouse_move = null_sink_mouse_move;
+    u->base.gamepad = uhid_sink_gamepad;
+    u->base.flush = sink_flush_noop;
+    for (int i = 0; i < UHID_MAX_PADS; i++) {
+        u->fds[i] = -1;
+    }
+}
+
+// Can gamepads be created at all? Returns 0 or -errno.
+static inline int uhid_sink_check(void) {
+    int fd = open(UHID_DEVICE_PATH, O_RDWR | O_CLOEXEC);
+    if (fd < 0) {
+        return -errno;
+    }
+    close(fd);
+    return 0;
+}
+
+// Remove every gamepad (closing the fd destroys the device)
+static inline void uhid_sink_close(UhidSink *u) {
+    for (int i = 0; i < UHID_MAX_PADS; i++) {
+        if (u->fds[i] >= 0) {
+            close(u->fds[i]);
+        }
+        u->fds[i] = -1;
+    }
+}
+
+#endif // __linux__
+
+#endif // SINK_UHID_H
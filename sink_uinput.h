@@ -0,0 +1,242 @@
+// sink_uinput.h
+// Linux output sink: a virtual keyboard/mouse created through uinput
+// Every event of one frame is buffered as a struct input_event and the
+// frame goes to the kernel as a single write() ending in one SYN_REPORT,
+// so a packet costs one syscall however many keys it changes. Needs write
+// access to /dev/uinput (root, or a udev rule for the input group).
+//
+// The sink writes to any file descriptor: uinput_sink_init() on a pipe,
+// a regular file or /dev/null gives the same byte stream without creating
+// a device (tests, benchmarks).
+//
+// The bindings use macOS virtual keycodes (see keymapping.h); they are
+// translated to Linux key codes here. Keycodes without a Linux equivalent
+// are ignored.
+
+#ifndef SINK_UINPUT_H
+#define SINK_UINPUT_H
+
+#ifdef __linux__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/uinput.h>
+#include "output_sink.h"
+
+#define UINPUT_DEVICE_PATH  "/dev/uinput"
+#define UINPUT_DEVICE_NAME  "Xbox Controller Keyboard/Mouse"
+#define UINPUT_MAX_EVENTS   (BATCH_MAX_EVENTS * 2)     // One frame, SYN_REPORT included
+
+// macOS virtual keycode (kVK_*) -> Linux KEY_* (0 = no equivalent)
+static const uint16_t uinput_keycodes[128] = {
+    [0x00] = KEY_A,          [0x01] = KEY_S,          [0x02] = KEY_D,
+    [0x03] = KEY_F,          [0x04] = KEY_H,          [0x05] = KEY_G,
+    [0x06] = KEY_Z,          [0x07] = KEY_X,          [0x08] = KEY_C,
+    [0x09] = KEY_V,          [0x0A] = KEY_102ND,      [0x0B] = KEY_B,
+    [0x0C] = KEY_Q,          [0x0D] = KEY_W,          [0x0E] = KEY_E,
+    [0x0F] = KEY_R,          [0x10] = KEY_Y,          [0x11] = KEY_T,
+    [0x12] = KEY_1,          [0x13] = KEY_2,          [0x14] = KEY_3,
+    [0x15] = KEY_4,          [0x16] = KEY_6,          [0x17] = KEY_5,
+    [0x18] = KEY_EQUAL,      [0x19] = KEY_9,          [0x1A] = KEY_7,
+    [0x1B] = KEY_MINUS,      [0x1C] = KEY_8,          [0x1D] = KEY_0,
+    [0x1E] = KEY_RIGHTBRACE, [0x1F] = KEY_O,          [0x20] = KEY_U,
+    [0x21] = KEY_LEFTBRACE,  [0x22] = KEY_I,          [0x23] = KEY_P,
+    [0x24] = KEY_ENTER,      [0x25] = KEY_L,          [0x26] = KEY_J,
+    [0x27] = KEY_APOSTROPHE, [0x28] = KEY_K,          [0x29] = KEY_SEMICOLON,
+    [0x2A] = KEY_BACKSLASH,  [0x2B] = KEY_COMMA,      [0x2C] = KEY_SLASH,
+    [0x2D] = KEY_N,          [0x2E] = KEY_M,          [0x2F] = KEY_DOT,
+    [0x30] = KEY_TAB,        [0x31] = KEY_SPACE,      [0x32] = KEY_GRAVE,
+    [0x33] = KEY_BACKSPACE,  [0x35] = KEY_ESC,        [0x36] = KEY_RIGHTMETA,
+    [0x37] = KEY_LEFTMETA,   [0x38] = KEY_LEFTSHIFT,  [0x39] = KEY_CAPSLOCK,
+    [0x3A] = KEY_LEFTALT,    [0x3B] = KEY_LEFTCTRL,   [0x3C] = KEY_RIGHTSHIFT,
+    [0x3D] = KEY_RIGHTALT,   [0x3E] = KEY_RIGHTCTRL,  [0x3F] = KEY_FN,
+    [0x40] = KEY_F17,        [0x41] = KEY_KPDOT,      [0x43] = KEY_KPASTERISK,
+    [0x45] = KEY_KPPLUS,     [0x47] = KEY_NUMLOCK,    [0x48] = KEY_VOLUMEUP,
+    [0x49] = KEY_VOLUMEDOWN, [0x4A] = KEY_MUTE,       [0x4B] = KEY_KPSLASH,
+    [0x4C] = KEY_KPENTER,    [0x4E] = KEY_KPMINUS,    [0x4F] = KEY_F18,
+    [0x50] = KEY_F19,        [0x51] = KEY_KPEQUAL,    [0x52] = KEY_KP0,
+    [0x53] = KEY_KP1,        [0x54] = KEY_KP2,        [0x55] = KEY_KP3,
+    [0x56] = KEY_KP4,        [0x57] = KEY_KP5,        [0x58] = KEY_KP6,
+    [0x59] = KEY_KP7,        [0x5A] = KEY_F20,        [0x5B] = KEY_KP8,
+    [0x5C] = KEY_KP9,        [0x5D] = KEY_YEN,        [0x5E] = KEY_RO,
+    [0x5F] = KEY_KPJPCOMMA,  [0x60] = KEY_F5,         [0x61] = KEY_F6,
+    [0x62] = KEY_F7,         [0x63] = KEY_F3,         [0x64] = KEY_F8,
+    [0x65] = KEY_F9,         [0x66] = KEY_MUHENKAN,   [0x67] = KEY_F11,
+    [0x68] = KEY_HENKAN,     [0x69] = KEY_F13,        [0x6A] = KEY_F16,
+    [0x6B] = KEY_F14,        [0x6D] = KEY_F10,        [0x6F] = KEY_F12,
+    [0x71] = KEY_F15,        [0x72] = KEY_INSERT,     [0x73] = KEY_HOME,
+    [0x74] = KEY_PAGEUP,     [0x75] = KEY_DELETE,     [0x76] = KEY_F4,
+    [0x77] = KEY_END,        [0x78] = KEY_F2,         [0x79] = KEY_PAGEDOWN,
+    [0x7A] = KEY_F1,         [0x7B] = KEY_LEFT,       [0x7C] = KEY_RIGHT,
+    [0x7D] = KEY_DOWN,       [0x7E] = KEY_UP,
+};
+
+static const uint16_t uinput_buttons[] = {
+    [MOUSE_BUTTON_LEFT] = BTN_LEFT,
+    [MOUSE_BUTTON_RIGHT] = BTN_RIGHT,
+    [MOUSE_BUTTON_MIDDLE] = BTN_MIDDLE,
+};
+
+typedef struct {
+    OutputSink base;
+    int fd;
+    bool created;               // fd is a uinput device we set up (and tear down)
+
+    // The frame being built; written out on flush
+    struct input_event events[UINPUT_MAX_EVENTS];
+    int count;
+
+    // Sub-pixel motion carried over to the next move, so slow stick
+    // movement isn't rounded away
+    float remainder_x;
+    float remainder_y;
+
+    unsigned long frames;       // write() calls
+    unsigned long written;      // Events written, SYN_REPORTs included
+    unsigned long failed;       // Frames the kernel didn't take
+} UinputSink;
+
+static inline void uinput_sink_push(UinputSink *u, uint16_t type, uint16_t code, int32_t value) {
+    // Leave room for the SYN_REPORT; an oversized frame is split
+    if (u->count == UINPUT_MAX_EVENTS - 1) {
+        u->base.flush(&u->base);
+    }
+    struct input_event *event = &u->events[u->count++];
+    memset(event, 0, sizeof(*event));   // The kernel timestamps uinput events
+    event->type = type;
+    event->code = code;
+    event->value = value;
+}
+
+static inline void uinput_sink_key(OutputSink *sink, uint16_t keycode, bool pressed) {
+    if (keycode < 128 && uinput_keycodes[keycode]) {
+        uinput_sink_push((UinputSink *)sink, EV_KEY, uinput_keycodes[keycode], pressed);
+    }
+}
+
+static inline void uinput_sink_mouse_button(OutputSink *sink, MouseButton button, bool pressed) {
+    if (button <= MOUSE_BUTTON_MIDDLE) {
+        uinput_sink_push((UinputSink *)sink, EV_KEY, uinput_buttons[button], pressed);
+    }
+}
+
+static inline void uinput_sink_mouse_move(OutputSink *sink, float dx, float dy) {
+    UinputSink *u = (UinputSink *)sink;
+    float x = dx + u->remainder_x;
+    float y = dy + u->remainder_y;
+    int32_t ix = (int32_t)x;
+    int32_t iy = (int32_t)y;
+    u->remainder_x = x - (float)ix;
+    u->remainder_y = y - (float)iy;
+
+    if (ix) {
+        uinput_sink_push(u, EV_REL, REL_X, ix);
+    }
+    if (iy) {
+        uinput_sink_push(u, EV_REL, REL_Y, iy);
+    }
+}
+
+// End of frame: everything buffered plus one SYN_REPORT in a single write
+static inline void uinput_sink_flush(OutputSink *sink) {
+    UinputSink *u = (UinputSink *)sink;
+    if (u->count == 0) {
+        return;
+    }
+    struct input_event *syn = &u->events[u->count++];
+    memset(syn, 0, sizeof(*syn));
+    syn->type = EV_SYN;
+    syn->code = SYN_REPORT;
+
+    size_t length = (size_t)u->count * sizeof(struct input_event);
+    ssize_t result;
+    do {
+        result = write(u->fd, u->events, length);
+    } while (result < 0 && errno == EINTR);
+
+    u->frames++;
+    if (result == (ssize_t)length) {
+        u->written += (unsigned long)u->count;
+    } else {
+        u->failed++;
+    }
+    u->count = 0;
+}
+
+// Use an already open descriptor as is (no device is created; the caller
+// keeps ownership of fd)
+static inline void uinput_sink_init(UinputSink *u, int fd) {
+    memset(u, 0, sizeof(*u));
+    u->base.name = "uinput";
+    u->base.key = uinput_sink_key;
+    u->base.mouse_button = uinput_sink_mouse_button;
+    u->base.mouse_move = uinput_sink_mouse_move;
+    u->base.gamepad = sink_gamepad_noop;
+    u->base.flush = uinput_sink_flush;
+    u->fd = fd;
+}
+
+// Register every key the bindings can produce, the mouse buttons and
+// relative motion, then create the device. Returns 0 or -errno.
+static inline int uinput_sink_create_device(int fd) {
+    if (ioctl(fd, UI_SET_EVBIT, EV_KEY) < 0 || ioctl(fd, UI_SET_EVBIT, EV_REL) < 0 ||
+        ioctl(fd, UI_SET_EVBIT, EV_SYN) < 0) {
+        return -errno;
+    }
+    for (int i = 0; i < 128; i++) {
+        if (uinput_keycodes[i]) {
+            ioctl(fd, UI_SET_KEYBIT, uinput_keycodes[i]);
+        }
+    }
+    for (int i = 0; i <= MOUSE_BUTTON_MIDDLE; i++) {
+        ioctl(fd, UI_SET_KEYBIT, uinput_buttons[i]);
+    }
+    ioctl(fd, UI_SET_RELBIT, REL_X);
+    ioctl(fd, UI_SET_RELBIT, REL_Y);
+
+    struct uinput_setup setup;
+    memset(&setup, 0, sizeof(setup));
+    setup.id.bustype = BUS_VIRTUAL;
+    strncpy(setup.name, UINPUT_DEVICE_NAME, UINPUT_MAX_NAME_SIZE - 1);
+    if (ioctl(fd, UI_DEV_SETUP, &setup) < 0 || ioctl(fd, UI_DEV_CREATE) < 0) {
+        return -errno;
+    }
+    return 0;
+}
+
+// Create the virtual keyboard/mouse. Returns 0 or -errno.
+static inline int uinput_sink_open(UinputSink *u) {
+    int fd = open(UINPUT_DEVICE_PATH, O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+        return -errno;
+    }
+    int result = uinput_sink_create_device(fd);
+    if (result < 0) {
+        close(fd);
+        return result;
+    }
+    uinput_sink_init(u, fd);
+    u->created = true;
+    return 0;
+}
+
+static inline void uinput_sink_close(UinputSink *u) {
+    if (u->fd < 0) {
+        return;
+    }
+    uinput_sink_flush(&u->base);
+    if (u->created) {
+        ioctl(u->fd, UI_DEV_DESTROY);
+        close(u->fd);
+    }
+    u->fd = -1;
+}
+
+#endif // __linux__
+
+#endif // SINK_UINPUT_H
@@ -0,0 +1,255 @@
+// stick_kernel.h
+// Vectorized stick math: both sticks' four axes in one pass
+// Lanes are {left x, left y, right x, right y}. The same kernel is written
+// once against a tiny 4-lane float type backed by SSE2 on x86, NEON on
+// 64-bit ARM, or plain arrays everywhere else (or with -DSTICK_KERNEL_SCALAR).
+
+#ifndef STICK_KERNEL_H
+#define STICK_KERNEL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+#include "response_curve.h"
+
+#define STICK_LANES 4
+
+// ============================================================================
+// 4-Lane Float Type
+// ============================================================================
+
+#if defined(__SSE2__) && !defined(STICK_KERNEL_SCALAR)
+
+#include <emmintrin.h>
+#define STICK_KERNEL_ISA "sse2"
+
+typedef __m128 Vec4;
+
+static inline Vec4 vec4_load(const float *p)          { return _mm_loadu_ps(p); }
+static inline void vec4_store(float *p, Vec4 v)       { _mm_storeu_ps(p, v); }
+static inline Vec4 vec4_set1(float x)                 { return _mm_set1_ps(x); }
+static inline Vec4 vec4_add(Vec4 a, Vec4 b)           { return _mm_add_ps(a, b); }
+static inline Vec4 vec4_sub(Vec4 a, Vec4 b)           { return _mm_sub_ps(a, b); }
+static inline Vec4 vec4_mul(Vec4 a, Vec4 b)           { return _mm_mul_ps(a, b); }
+static inline Vec4 vec4_div(Vec4 a, Vec4 b)           { return _mm_div_ps(a, b); }
+static inline Vec4 vec4_min(Vec4 a, Vec4 b)           { return _mm_min_ps(a, b); }
+static inline Vec4 vec4_sqrt(Vec4 a)                  { return _mm_sqrt_ps(a); }
+static inline Vec4 vec4_abs(Vec4 a)                   { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+
+// {a1, a0, a3, a2}: x <-> y within each stick
+static inline Vec4 vec4_swap_pairs(Vec4 a) {
+    return _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1));
+}
+
+// Per lane: a < b ? x : y
+static inline Vec4 vec4_select_lt(Vec4 a, Vec4 b, Vec4 x, Vec4 y) {
+    __m128 mask = _mm_cmplt_ps(a, b);
+    return _mm_or_ps(_mm_and_ps(mask, x), _mm_andnot_ps(mask, y));
+}
+
+// Magnitude of mag with the sign of sign
+static inline Vec4 vec4_copysign(Vec4 mag, Vec4 sign) {
+    __m128 bit = _mm_set1_ps(-0.0f);
+    return _mm_or_ps(_mm_andnot_ps(bit, mag), _mm_and_ps(bit, sign));
+}
+
+// True if a < b in any lane
+static inline bool vec4_any_lt(Vec4 a, Vec4 b) {
+    return _mm_movemask_ps(_mm_cmplt_ps(a, b)) != 0;
+}
+
+static inline Vec4 vec4_from_i16(const int16_t *p) {
+    __m128i v = _mm_loadl_epi64((const __m128i *)p);
+    v = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+    return _mm_cvtepi32_ps(v);
+}
+
+// Truncates toward zero, saturates to int16
+static inline void vec4_to_i16(int16_t *p, Vec4 v) {
+    __m128i i = _mm_cvttps_epi32(v);
+    _mm_storel_epi64((__m128i *)p, _mm_packs_epi32(i, i));
+}
+
+static inline void vec4_to_i32(int32_t *p, Vec4 v) {
+    _mm_storeu_si128((__m128i *)p, _mm_cvttps_epi32(v));
+}
+
+#elif defined(__ARM_NEON) && defined(__aarch64__) && !defined(STICK_KERNEL_SCALAR)
+
+#include <arm_neon.h>
+#define STICK_KERNEL_ISA "neon"
+
+typedef float32x4_t Vec4;
+
+static inline Vec4 vec4_load(const float *p)          { return vld1q_f32(p); }
+static inline void vec4_store(float *p, Vec4 v)       { vst1q_f32(p, v); }
+static inline Vec4 vec4_set1(float x)                 { return vdupq_n_f32(x); }
+static inline Vec4 vec4_add(Vec4 a, Vec4 b)           { return vaddq_f32(a, b); }
+static inline Vec4 vec4_sub(Vec4 a, Vec4 b)           { return vsubq_f32(a, b); }
+static inline Vec4 vec4_mul(Vec4 a, Vec4 b)           { return vmulq_f32(a, b); }
+static inline Vec4 vec4_div(Vec4 a, Vec4 b)           { return vdivq_f32(a, b); }
+static inline Vec4 vec4_min(Vec4 a, Vec4 b)           { return vminq_f32(a, b); }
+static inline Vec4 vec4_sqrt(Vec4 a)                  { return vsqrtq_f32(a); }
+static inline Vec4 vec4_abs(Vec4 a)                   { return vabsq_f32(a); }
+static inline Vec4 vec4_swap_pairs(Vec4 a)            { return vrev64q_f32(a); }
+
+static inline Vec4 vec4_select_lt(Vec4 a, Vec4 b, Vec4 x, Vec4 y) {
+    return vbslq_f32(vcltq_f32(a, b), x, y);
+}
+
+static inline Vec4 vec4_copysign(Vec4 mag, Vec4 sign) {
+    return vbslq_f32(vdupq_n_u32(0x80000000u), sign, mag);
+}
+
+static inline bool vec4_any_lt(Vec4 a, Vec4 b) {
+    return vmaxvq_u32(vcltq_f32(a, b)) != 0;
+}
+
+static inline Vec4 vec4_from_i16(const int16_t *p) {
+    return vcvtq_f32_s32(vmovl_s16(vld1_s16(p)));
+}
+
+static inline void vec4_to_i16(int16_t *p, Vec4 v) {
+    vst1_s16(p, vqmovn_s32(vcvtq_s32_f32(v)));
+}
+
+static inline void vec4_to_i32(int32_t *p, Vec4 v) {
+    vst1q_s32(p, vcvtq_s32_f32(v));
+}
+
+#else
+
+#define STICK_KERNEL_ISA "scalar"
+
+typedef struct {
+    float v[STICK_LANES];
+} Vec4;
+
+#define VEC4_MAP(expr) \
+    Vec4 r; \
+    for (int i = 0; i < STICK_LANES; i++) r.v[i] = (expr); \
+    return r
+
+static inline Vec4 vec4_load(const float *p)          { VEC4_MAP(p[i]); }
+static inline void vec4_store(float *p, Vec4 v)       { for (int i = 0; i < STICK_LANES; i++) p[i] = v.v[i]; }
+static inline Vec4 vec4_set1(float x)                 { VEC4_MAP(x); }
+static inline Vec4 vec4_add(Vec4 a, Vec4 b)           { VEC4_MAP(a.v[i] + b.v[i]); }
+static inline Vec4 vec4_sub(Vec4 a, Vec4 b)           { VEC4_MAP(a.v[i] - b.v[i]); }
+static inline Vec4 vec4_mul(Vec4 a, Vec4 b)           { VEC4_MAP(a.v[i] * b.v[i]); }
+static inline Vec4 vec4_div(Vec4 a, Vec4 b)           { VEC4_MAP(a.v[i] / b.v[i]); }
+static inline Vec4 vec4_min(Vec4 a, Vec4 b)           { VEC4_MAP(a.v[i] < b.v[i] ? a.v[i] : b.v[i]); }
+static inline Vec4 vec4_sqrt(Vec4 a)                  { VEC4_MAP(sqrtf(a.v[i])); }
+static inline Vec4 vec4_abs(Vec4 a)                   { VEC4_MAP(fabsf(a.v[i])); }
+static inline Vec4 vec4_swap_pairs(Vec4 a)            { VEC4_MAP(a.v[i ^ 1]); }
+
+static inline Vec4 vec4_select_lt(Vec4 a, Vec4 b, Vec4 x, Vec4 y) {
+    VEC4_MAP(a.v[i] < b.v[i] ? x.v[i] : y.v[i]);
+}
+
+static inline Vec4 vec4_copysign(Vec4 mag, Vec4 sign) {
+    VEC4_MAP(copysignf(mag.v[i], sign.v[i]));
+}
+
+static inline bool vec4_any_lt(Vec4 a, Vec4 b) {
+    for (int i = 0; i < STICK_LANES; i++) {
+        if (a.v[i] < b.v[i]) return true;
+    }
+    return false;
+}
+
+static inline Vec4 vec4_from_i16(const int16_t *p)    { VEC4_MAP((float)p[i]); }
+
+static inline void vec4_to_i16(int16_t *p, Vec4 v) {
+    for (int i = 0; i < STICK_LANES; i++) {
+        float x = v.v[i];
+        p[i] = x >= 32767.0f ? 32767 : x <= -32768.0f ? -32768 : (int16_t)x;
+    }
+}
+
+static inline void vec4_to_i32(int32_t *p, Vec4 v) {
+    for (int i = 0; i < STICK_LANES; i++) p[i] = (int32_t)v.v[i];
+}
+
+#undef VEC4_MAP
+
+#endif
+
+// ============================================================================
+// Stick Kernels
+// ============================================================================
+
+// Radial deadzone and unit-circle clamp for both sticks. Each stick's
+// squared magnitude lands in both of its lanes, so x and y are scaled
+// together exactly like apply_deadzone(). With only four lanes the
+// int16 conversions cost more than the math saves, so the mapper uses
+// the scalar apply_deadzone(); this stays for bench.c to compare against.
+static inline void stick_kernel_deadzone(const int16_t in[STICK_LANES], int16_t out[STICK_LANES],
+                                         float deadzone_sq) {
+    const Vec4 zero = vec4_set1(0.0f);
+    const Vec4 one = vec4_set1(1.0f);
+    const Vec4 limit_sq = vec4_set1(32767.0f * 32767.0f);
+
+    Vec4 v = vec4_from_i16(in);
+    Vec4 sq = vec4_mul(v, v);
+    Vec4 mag_sq = vec4_add(sq, vec4_swap_pairs(sq));
+
+    // Outside the unit circle: pull back onto it. Only the corners get
+    // there, so the square root is skipped unless some lane needs it (lanes
+    // inside compute an unused quotient, possibly inf, which the select discards)
+    Vec4 scale = one;
+    if (vec4_any_lt(limit_sq, mag_sq)) {
+        Vec4 clamp = vec4_div(vec4_set1(32767.0f), vec4_sqrt(mag_sq));
+        scale = vec4_select_lt(limit_sq, mag_sq, clamp, one);
+    }
+    scale = vec4_select_lt(mag_sq, vec4_set1(deadzone_sq), zero, scale);
+
+    vec4_to_i16(out, vec4_mul(v, scale));
+}
+
+// Mouse movement for one output tick from both sticks' held positions:
+// axis swap, normalization, exponential smoothing, response curve and gain.
+// gain holds each lane's sensitivity (0 for sticks not in mouse mode);
+// smoothed is the per-lane smoothing state in cursor space.
+static inline void stick_kernel_mouse(const int16_t position[STICK_LANES],
+                                      float smoothed[STICK_LANES],
+                                      const float gain[STICK_LANES], const Lut *curve,
+                                      float alpha, float scale, float *dx, float *dy) {
+    // Axes are swapped in the controller (physical left/right is reported in
+    // Y), and pushing up should move the cursor up
+    static const float axis_scale[STICK_LANES] = {
+        1.0f / 32767.0f, -1.0f / 32767.0f, 1.0f / 32767.0f, -1.0f / 32767.0f
+    };
+    const Vec4 lut_size = vec4_set1((float)LUT_SIZE);
+
+    Vec4 target = vec4_mul(vec4_swap_pairs(vec4_from_i16(position)), vec4_load(axis_scale));
+
+    Vec4 a = vec4_set1(alpha);
+    Vec4 s = vec4_add(vec4_mul(a, target),
+                      vec4_mul(vec4_sub(vec4_set1(1.0f), a), vec4_load(smoothed)));
+    vec4_store(smoothed, s);
+
+    // Response curve: table positions are computed in vector form, the
+    // four table reads are scalar, the interpolation is vector again
+    Vec4 pos = vec4_min(vec4_mul(vec4_abs(s), lut_size), lut_size);
+    int32_t index[STICK_LANES];
+    float base[STICK_LANES], lo[STICK_LANES], hi[STICK_LANES];
+    vec4_to_i32(index, pos);
+    for (int i = 0; i < STICK_LANES; i++) {
+        int k = index[i] < LUT_SIZE ? index[i] : LUT_SIZE - 1;
+        base[i] = (float)k;
+        lo[i] = curve->values[k];
+        hi[i] = curve->values[k + 1];
+    }
+    Vec4 vlo = vec4_load(lo);
+    Vec4 frac = vec4_sub(pos, vec4_load(base));
+    Vec4 curved = vec4_add(vlo, vec4_mul(vec4_sub(vec4_load(hi), vlo), frac));
+
+    Vec4 out = vec4_mul(vec4_mul(vec4_copysign(curved, s), vec4_load(gain)), vec4_set1(scale));
+
+    float lanes[STICK_LANES];
+    vec4_store(lanes, out);
+    *dx += lanes[0] + lanes[2];
+    *dy += lanes[1] + lanes[3];
+}
+
+#endif // STICK_KERNEL_H
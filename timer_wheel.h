@@ -0,0 +1,167 @@
+// timer_wheel.h
+// Hashed timer wheel for timed actions (tap-hold, turbo, macros, chords)
+// Time is cut into fixed ticks (1 ms by default) and a timer lives in the
+// slot its expiry tick hashes to, in an intrusive doubly linked list:
+// scheduling and cancelling are O(1) and allocate nothing. A bitmap of
+// occupied slots lets an advance jump straight to the next slot that holds
+// anything, so the cost of moving the clock depends on the timers that are
+// due, not on how many are pending. Timers further out than one turn of the
+// wheel simply stay in their slot until their round comes up.
+//
+// The wheel has no clock of its own: the owner advances it with whatever
+// clock drives it (monotonic time live, capture time when replaying).
+
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include "timing.h"
+
+#define TIMER_WHEEL_SLOTS       256     // Power of two
+#define TIMER_WHEEL_RESOLUTION  NS_PER_MS
+
+typedef struct TimerNode TimerNode;
+struct TimerNode {
+    TimerNode *next;
+    TimerNode *prev;
+    uint64_t expires;           // Tick
+    uint64_t deadline_ns;       // As requested; expiry is rounded up to a tick
+    bool pending;
+
+    // Called once the wheel reaches the deadline. May reschedule the node
+    // (relative to deadline_ns, so periodic timers don't drift).
+    void (*fire)(TimerNode *node);
+    void *owner;
+    int arg;
+};
+
+typedef struct {
+    TimerNode *slots[TIMER_WHEEL_SLOTS];
+    uint64_t occupied[TIMER_WHEEL_SLOTS / 64];
+    uint64_t resolution_ns;
+    uint64_t current;           // Last tick processed
+    unsigned int pending;       // Timers scheduled
+} TimerWheel;
+
+static inline void timer_wheel_init(TimerWheel *w, uint64_t resolution_ns, uint64_t now_ns) {
+    memset(w, 0, sizeof(*w));
+    w->resolution_ns = resolution_ns;
+    w->current = now_ns / resolution_ns;
+}
+
+static inline void timer_node_init(TimerNode *node, void (*fire)(TimerNode *node),
+                                   void *owner, int arg) {
+    memset(node, 0, sizeof(*node));
+    node->fire = fire;
+    node->owner = owner;
+    node->arg = arg;
+}
+
+static inline void timer_wheel_link(TimerWheel *w, TimerNode *node) {
+    unsigned int slot = (unsigned int)(node->expires & (TIMER_WHEEL_SLOTS - 1));
+    node->prev = NULL;
+    node->next = w->slots[slot];
+    if (node->next) {
+        node->next->prev = node;
+    }
+    w->slots[slot] = node;
+    w->occupied[slot / 64] |= 1ULL << (slot % 64);
+}
+
+static inline void timer_wheel_cancel(TimerWheel *w, TimerNode *node) {
+    if (!node->pending) {
+        return;
+    }
+    unsigned int slot = (unsigned int)(node->expires & (TIMER_WHEEL_SLOTS - 1));
+    if (node->prev) {
+        node->prev->next = node->next;
+    } else {
+        w->slots[slot] = node->next;
+        if (!node->next) {
+            w->occupied[slot / 64] &= ~(1ULL << (slot % 64));
+        }
+    }
+    if (node->next) {
+        node->next->prev = node->prev;
+    }
+    node->pending = false;
+    w->pending--;
+}
+
+// (Re)schedule node to fire once the wheel reaches deadline_ns. A deadline
+// that has already passed fires on the next tick.
+static inline void timer_wheel_schedule(TimerWheel *w, TimerNode *node, uint64_t deadline_ns) {
+    timer_wheel_cancel(w, node);
+    uint64_t expires = (deadline_ns + w->resolution_ns - 1) / w->resolution_ns;
+    node->expires = expires > w->current ? expires : w->current + 1;
+    node->deadline_ns = deadline_ns;
+    node->pending = true;
+    w->pending++;
+    timer_wheel_link(w, node);
+}
+
+// Next occupied slot after the current tick, as a tick; 0 if none
+static inline uint64_t timer_wheel_next_tick(const TimerWheel *w) {
+    if (w->pending == 0) {
+        return 0;
+    }
+    unsigned int start = (unsigned int)((w->current + 1) & (TIMER_WHEEL_SLOTS - 1));
+    for (unsigned int i = 0; i <= TIMER_WHEEL_SLOTS / 64; i++) {
+        unsigned int word = ((start / 64) + i) % (TIMER_WHEEL_SLOTS / 64);
+        uint64_t bits = w->occupied[word];
+        if (i == 0) {
+            bits &= ~0ULL << (start % 64);          // Slots before start come last
+        } else if (i == TIMER_WHEEL_SLOTS / 64) {
+            bits &= (1ULL << (start % 64)) - 1;
+        }
+        if (bits) {
+            unsigned int slot = word * 64 + (unsigned int)__builtin_ctzll(bits);
+            unsigned int distance = (slot - start) & (TIMER_WHEEL_SLOTS - 1);
+            return w->current + 1 + distance;
+        }
+    }
+    return 0;
+}
+
+// When the owner next needs to advance the wheel, or UINT64_MAX if nothing
+// is scheduled. Can be early (a slot may only hold timers for a later
+// round), never late.
+static inline uint64_t timer_wheel_next_ns(const TimerWheel *w) {
+    uint64_t tick = timer_wheel_next_tick(w);
+    return tick ? tick * w->resolution_ns : UINT64_MAX;
+}
+
+// Fire every timer due by now_ns, tick by tick
+static inline void timer_wheel_advance(TimerWheel *w, uint64_t now_ns) {
+    uint64_t target = now_ns / w->resolution_ns;
+    while (w->current < target) {
+        uint64_t tick = timer_wheel_next_tick(w);
+        if (tick == 0 || tick > target) {
+            break;
+        }
+        w->current = tick;
+
+        // Fire one due timer at a time and look again: a callback may
+        // cancel or schedule other timers, in this slot too. Timers for a
+        // later round stay where they are.
+        unsigned int slot = (unsigned int)(tick & (TIMER_WHEEL_SLOTS - 1));
+        TimerNode *node = w->slots[slot];
+        while (node) {
+            if (node->expires <= tick) {
+                timer_wheel_cancel(w, node);
+                node->fire(node);
+                node = w->slots[slot];
+            } else {
+                node = node->next;
+            }
+        }
+    }
+    if (w->current < target) {
+        w->current = target;
+    }
+}
+
+#endif // TIMER_WHEEL_H
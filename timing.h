@@ -0,0 +1,74 @@
+// timing.h
+// Monotonic clock helpers for the output scheduler
+// All deadlines in the driver are expressed in nanoseconds on CLOCK_MONOTONIC
+
+#ifndef TIMING_H
+#define TIMING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+
+#define NS_PER_US   1000ULL
+#define NS_PER_MS   1000000ULL
+#define NS_PER_SEC  1000000000ULL
+
+// Current monotonic time in nanoseconds (never jumps with wall-clock changes)
+static inline uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * NS_PER_SEC + (uint64_t)ts.tv_nsec;
+}
+
+// Microseconds from now until deadline (0 if it has already passed)
+static inline long us_until(uint64_t deadline_ns, uint64_t now_ns) {
+    if (deadline_ns <= now_ns) {
+        return 0;
+    }
+    return (long)((deadline_ns - now_ns + NS_PER_US - 1) / NS_PER_US);
+}
+
+// Sleep until the monotonic deadline (returns early if a signal arrives)
+static inline void sleep_until_ns(uint64_t deadline_ns) {
+    uint64_t now = monotonic_ns();
+    if (deadline_ns <= now) {
+        return;
+    }
+    uint64_t remaining = deadline_ns - now;
+    struct timespec ts = { (time_t)(remaining / NS_PER_SEC), (long)(remaining % NS_PER_SEC) };
+    nanosleep(&ts, NULL);
+}
+
+// ============================================================================
+// Fixed-rate tick schedule
+// ============================================================================
+
+typedef struct {
+    uint64_t period_ns;
+    uint64_t last_ns;
+    uint64_t next_ns;
+} TickScheduler;
+
+static inline void tick_scheduler_init(TickScheduler *t, uint32_t rate_hz, uint64_t now_ns) {
+    t->period_ns = NS_PER_SEC / (rate_hz ? rate_hz : 250);
+    t->last_ns = now_ns;
+    t->next_ns = now_ns + t->period_ns;
+}
+
+// Returns true when a tick is due at now_ns and stores the time since the
+// previous tick in *dt_ns. A schedule that fell more than a period behind
+// restarts from now instead of firing a burst of catch-up ticks.
+static inline bool tick_scheduler_due(TickScheduler *t, uint64_t now_ns, uint64_t *dt_ns) {
+    if (now_ns < t->next_ns) {
+        return false;
+    }
+    *dt_ns = now_ns - t->last_ns;
+    t->last_ns = now_ns;
+    t->next_ns += t->period_ns;
+    if (t->next_ns <= now_ns) {
+        t->next_ns = now_ns + t->period_ns;
+    }
+    return true;
+}
+
+#endif // TIMING_H
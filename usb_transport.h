@@ -0,0 +1,410 @@
+// usb_transport.h
+// Asynchronous USB input engine for Xbox One controllers
+// Keeps several interrupt IN transfers queued at all times so the controller
+// never has to wait for the host to ask for the next packet.
+// Output goes through an asynchronous queue as well, so acks, commands and
+// rumble never block the thread that reads input.
+
+#ifndef USB_TRANSPORT_H
+#define USB_TRANSPORT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <libusb.h>
+#include "timing.h"
+
+#define USB_PACKET_SIZE         64   // Max GIP packet on the interrupt endpoint
+#define USB_MAX_IN_TRANSFERS    16   // Upper bound for transfers in flight
+#define USB_PACKET_QUEUE_SIZE   64   // Completed packets awaiting processing (power of two)
+#define USB_OUT_QUEUE_SIZE      16   // OUT packets waiting to be sent (power of two)
+#define USB_OUT_TIMEOUT_MS      250  // Give up on one OUT packet after this long
+
+// One completed IN transfer, copied out of the transfer buffer so the
+// transfer can be resubmitted before the packet is processed
+typedef struct {
+    uint8_t data[USB_PACKET_SIZE];
+    int length;
+    uint64_t timestamp_ns;      // monotonic_ns() when the transfer completed
+} UsbPacket;
+
+typedef void (*UsbPacketHandler)(void *user, const uint8_t *data, int length,
+                                 uint64_t timestamp_ns);
+
+typedef struct {
+    libusb_device_handle *handle;
+    uint8_t endpoint;
+    int num_transfers;
+    int in_flight;              // Transfers currently owned by libusb
+    int error;                  // First fatal error seen by a callback
+
+    // Each transfer owns its buffer (freed with it), so one that libusb
+    // never gives back can be left behind without sharing memory with
+    // the transfers of a restarted engine
+    struct libusb_transfer *transfers[USB_MAX_IN_TRANSFERS];
+    bool owned[USB_MAX_IN_TRANSFERS];   // transfers[i] is owned by libusb
+
+    // Filled by completion callbacks, drained by usb_input_drain()
+    UsbPacket queue[USB_PACKET_QUEUE_SIZE];
+    unsigned int queue_head;
+    unsigned int queue_tail;
+    unsigned long dropped;      // Packets lost because the queue was full
+} UsbInputEngine;
+
+// ============================================================================
+// Completion Callback
+// ============================================================================
+
+// libusb gave transfer slot back for good (error is 0 when cancelled)
+static inline void usb_input_returned(UsbInputEngine *engine, int slot, int error) {
+    engine->owned[slot] = false;
+    engine->in_flight--;
+    if (error) {
+        engine->error = error;
+    }
+}
+
+// Which of the engine's transfers this is; -1 for one that usb_input_stop()
+// had to leave with libusb and that has since come back
+static inline int usb_input_slot(const UsbInputEngine *engine,
+                                 const struct libusb_transfer *transfer) {
+    for (int i = 0; i < engine->num_transfers; i++) {
+        if (engine->transfers[i] == transfer) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static inline void LIBUSB_CALL usb_input_callback(struct libusb_transfer *transfer) {
+    UsbInputEngine *engine = (UsbInputEngine *)transfer->user_data;
+    int slot = usb_input_slot(engine, transfer);
+    if (slot < 0) {
+        // The engine has moved on and may have been restarted since;
+        // nothing in it belongs to this transfer any more
+        libusb_free_transfer(transfer);
+        return;
+    }
+
+    switch (transfer->status) {
+        case LIBUSB_TRANSFER_COMPLETED:
+            if (engine->queue_tail - engine->queue_head < USB_PACKET_QUEUE_SIZE) {
+                UsbPacket *packet = &engine->queue[engine->queue_tail % USB_PACKET_QUEUE_SIZE];
+                memcpy(packet->data, transfer->buffer, transfer->actual_length);
+                packet->length = transfer->actual_length;
+                packet->timestamp_ns = monotonic_ns();
+                engine->queue_tail++;
+            } else {
+                engine->dropped++;
+            }
+            break;
+        case LIBUSB_TRANSFER_TIMED_OUT:
+            break;
+        case LIBUSB_TRANSFER_CANCELLED:
+            usb_input_returned(engine, slot, 0);
+            return;
+        case LIBUSB_TRANSFER_NO_DEVICE:
+            usb_input_returned(engine, slot, LIBUSB_ERROR_NO_DEVICE);
+            return;
+        case LIBUSB_TRANSFER_STALL:
+            usb_input_returned(engine, slot, LIBUSB_ERROR_PIPE);
+            return;
+        default:
+            usb_input_returned(engine, slot, LIBUSB_ERROR_IO);
+            return;
+    }
+
+    // Hand the transfer straight back to libusb so there is never a gap
+    // between completion and the next read on this slot
+    int result = libusb_submit_transfer(transfer);
+    if (result < 0) {
+        usb_input_returned(engine, slot, result);
+    }
+}
+
+// ============================================================================
+// Engine Control
+// ============================================================================
+
+// Allocate and submit num_transfers interrupt IN transfers.
+// Returns 0 on success or a libusb error code.
+static inline int usb_input_start(UsbInputEngine *engine, libusb_device_handle *handle,
+                                  uint8_t endpoint, int num_transfers) {
+    memset(engine, 0, sizeof(*engine));
+    engine->handle = handle;
+    engine->endpoint = endpoint;
+
+    if (num_transfers < 1) num_transfers = 1;
+    if (num_transfers > USB_MAX_IN_TRANSFERS) num_transfers = USB_MAX_IN_TRANSFERS;
+    engine->num_transfers = num_transfers;
+
+    for (int i = 0; i < num_transfers; i++) {
+        struct libusb_transfer *transfer = libusb_alloc_transfer(0);
+        uint8_t *buffer = malloc(USB_PACKET_SIZE);
+        if (!transfer || !buffer) {
+            libusb_free_transfer(transfer);
+            free(buffer);
+            return LIBUSB_ERROR_NO_MEM;
+        }
+        engine->transfers[i] = transfer;
+
+        // Timeout 0: the transfer stays queued until the controller sends data
+        libusb_fill_interrupt_transfer(transfer, handle, endpoint, buffer,
+                                       USB_PACKET_SIZE, usb_input_callback, engine, 0);
+        transfer->flags = LIBUSB_TRANSFER_FREE_BUFFER;
+
+        int result = libusb_submit_transfer(transfer);
+        if (result < 0) {
+            return result;
+        }
+        engine->owned[i] = true;
+        engine->in_flight++;
+    }
+
+    return 0;
+}
+
+// Wait up to timeout_us for transfer completions. One call serves every
+// engine sharing the libusb context.
+static inline int usb_wait_events(libusb_context *ctx, long timeout_us) {
+    struct timeval tv = { timeout_us / 1000000, timeout_us % 1000000 };
+    int result = libusb_handle_events_timeout_completed(ctx, &tv, NULL);
+    if (result < 0 && result != LIBUSB_ERROR_INTERRUPTED) {
+        return result;
+    }
+    return 0;
+}
+
+// Hand every queued packet to handler in arrival order. All packets that
+// completed during one wakeup are drained together.
+// Returns the number of packets handled, or a libusb error code once the
+// device is gone or every transfer has failed. LIBUSB_ERROR_PIPE (stall) is
+// reported as soon as it happens; see usb_input_clear_stall().
+static inline int usb_input_drain(UsbInputEngine *engine, UsbPacketHandler handler, void *user) {
+    int handled = 0;
+    while (engine->queue_head != engine->queue_tail) {
+        UsbPacket *packet = &engine->queue[engine->queue_head % USB_PACKET_QUEUE_SIZE];
+        handler(user, packet->data, packet->length, packet->timestamp_ns);
+        engine->queue_head++;
+        handled++;
+    }
+
+    // A stalled endpoint stays stalled until the host clears it, so don't
+    // wait for the remaining transfers to fail as well
+    if (engine->error == LIBUSB_ERROR_PIPE) {
+        return LIBUSB_ERROR_PIPE;
+    }
+
+    if (handled == 0 && engine->in_flight == 0) {
+        return engine->error ? engine->error : LIBUSB_ERROR_IO;
+    }
+    return handled;
+}
+
+// Cancel all outstanding transfers and wait for libusb to give them back.
+// A transfer is only freed once its callback has run; any that libusb
+// still holds after ~1 second is left to it (it frees itself if it ever
+// comes back) and counted in the return value.
+static inline int usb_input_stop(UsbInputEngine *engine, libusb_context *ctx) {
+    for (int i = 0; i < engine->num_transfers; i++) {
+        if (engine->owned[i]) {
+            libusb_cancel_transfer(engine->transfers[i]);
+        }
+    }
+
+    // Cancellation completes asynchronously
+    for (int i = 0; i < 100 && engine->in_flight > 0; i++) {
+        struct timeval tv = { 0, 10000 };
+        libusb_handle_events_timeout_completed(ctx, &tv, NULL);
+    }
+
+    int leaked = 0;
+    for (int i = 0; i < engine->num_transfers; i++) {
+        if (engine->owned[i]) {
+            leaked++;
+        } else {
+            libusb_free_transfer(engine->transfers[i]);
+        }
+        engine->transfers[i] = NULL;
+        engine->owned[i] = false;
+    }
+    engine->in_flight = 0;
+    return leaked;
+}
+
+// Recover from a stalled endpoint: cancel the remaining transfers, clear the
+// halt and queue fresh ones. Drain first; packets still queued are dropped.
+// LIBUSB_ERROR_BUSY if a transfer never came back from cancellation.
+static inline int usb_input_clear_stall(UsbInputEngine *engine, libusb_context *ctx) {
+    libusb_device_handle *handle = engine->handle;
+    uint8_t endpoint = engine->endpoint;
+    int num_transfers = engine->num_transfers;
+
+    if (usb_input_stop(engine, ctx) > 0) {
+        return LIBUSB_ERROR_BUSY;
+    }
+    int result = libusb_clear_halt(handle, endpoint);
+    if (result < 0) {
+        return result;
+    }
+    return usb_input_start(engine, handle, endpoint, num_transfers);
+}
+
+// ============================================================================
+// Output Queue
+// ============================================================================
+
+// One OUT packet waiting its turn. A replaceable packet (rumble) is
+// overwritten by the next replaceable packet with the same command while it
+// is still waiting, so only the latest state goes out.
+typedef struct {
+    uint8_t data[USB_PACKET_SIZE];
+    int length;
+    bool replaceable;
+} UsbOutPacket;
+
+// OUT packets are sent one at a time, in order, with a single transfer
+typedef struct {
+    libusb_device_handle *handle;
+    uint8_t endpoint;
+    struct libusb_transfer *transfer;   // Owns its buffer, like the IN transfers
+    bool busy;                  // transfer is owned by libusb
+    int error;                  // Fatal error (device gone); nothing more is sent
+
+    UsbOutPacket queue[USB_OUT_QUEUE_SIZE];
+    unsigned int queue_head;
+    unsigned int queue_tail;
+
+    unsigned long sent;
+    unsigned long merged;       // Replaced by a newer packet before being sent
+    unsigned long dropped;      // Queue full
+    unsigned long failed;       // Transfer errors and timeouts
+} UsbOutputQueue;
+
+static inline void usb_output_submit_next(UsbOutputQueue *out);
+
+static inline void LIBUSB_CALL usb_output_callback(struct libusb_transfer *transfer) {
+    UsbOutputQueue *out = (UsbOutputQueue *)transfer->user_data;
+    if (out->transfer != transfer) {
+        // Left behind by usb_output_stop(); the queue has moved on
+        libusb_free_transfer(transfer);
+        return;
+    }
+    out->busy = false;
+
+    switch (transfer->status) {
+        case LIBUSB_TRANSFER_COMPLETED:
+            out->sent++;
+            break;
+        case LIBUSB_TRANSFER_CANCELLED:
+            return;
+        case LIBUSB_TRANSFER_NO_DEVICE:
+            out->error = LIBUSB_ERROR_NO_DEVICE;
+            return;
+        default:
+            out->failed++;      // Lose this packet, keep going with the next
+            break;
+    }
+    usb_output_submit_next(out);
+}
+
+static inline void usb_output_submit_next(UsbOutputQueue *out) {
+    if (out->busy || out->error || out->queue_head == out->queue_tail) {
+        return;
+    }
+    UsbOutPacket *packet = &out->queue[out->queue_head % USB_OUT_QUEUE_SIZE];
+    uint8_t *buffer = out->transfer->buffer;
+    memcpy(buffer, packet->data, packet->length);
+    libusb_fill_interrupt_transfer(out->transfer, out->handle, out->endpoint, buffer,
+                                   packet->length, usb_output_callback, out, USB_OUT_TIMEOUT_MS);
+    out->queue_head++;
+
+    int result = libusb_submit_transfer(out->transfer);
+    if (result < 0) {
+        out->error = result;
+        return;
+    }
+    out->busy = true;
+}
+
+static inline int usb_output_start(UsbOutputQueue *out, libusb_device_handle *handle,
+                                   uint8_t endpoint) {
+    memset(out, 0, sizeof(*out));
+    out->handle = handle;
+    out->endpoint = endpoint;
+    struct libusb_transfer *transfer = libusb_alloc_transfer(0);
+    uint8_t *buffer = malloc(USB_PACKET_SIZE);
+    if (!transfer || !buffer) {
+        libusb_free_transfer(transfer);
+        free(buffer);
+        return LIBUSB_ERROR_NO_MEM;
+    }
+    transfer->buffer = buffer;
+    transfer->flags = LIBUSB_TRANSFER_FREE_BUFFER;
+    out->transfer = transfer;
+    return 0;
+}
+
+// Queue a packet; never blocks. With replace set, a waiting packet with
+// the same command that was also queued with replace is overwritten instead.
+// Returns false if the packet was dropped.
+static inline bool usb_output_send(UsbOutputQueue *out, const uint8_t *data, int length,
+                                   bool replace) {
+    if (!out->transfer || out->error || length < 1 || length > USB_PACKET_SIZE) {
+        return false;
+    }
+
+    UsbOutPacket *packet = NULL;
+    if (replace) {
+        for (unsigned int i = out->queue_head; i != out->queue_tail; i++) {
+            UsbOutPacket *waiting = &out->queue[i % USB_OUT_QUEUE_SIZE];
+            if (waiting->replaceable && waiting->data[0] == data[0]) {
+                packet = waiting;
+                out->merged++;
+                break;
+            }
+        }
+    }
+    if (!packet) {
+        if (out->queue_tail - out->queue_head == USB_OUT_QUEUE_SIZE) {
+            out->dropped++;
+            return false;
+        }
+        packet = &out->queue[out->queue_tail % USB_OUT_QUEUE_SIZE];
+        out->queue_tail++;
+    }
+
+    memcpy(packet->data, data, length);
+    packet->length = length;
+    packet->replaceable = replace;
+    usb_output_submit_next(out);
+    return true;
+}
+
+// Cancel the packet in flight, drop the rest and free the transfer once
+// libusb has given it back. Returns 1 if it never did within ~1 second;
+// the transfer is then left to libusb and frees itself if it comes back.
+static inline int usb_output_stop(UsbOutputQueue *out, libusb_context *ctx) {
+    if (!out->transfer) {
+        return 0;
+    }
+    out->queue_head = out->queue_tail;
+    if (out->busy) {
+        libusb_cancel_transfer(out->transfer);
+    }
+    for (int i = 0; i < 100 && out->busy; i++) {
+        struct timeval tv = { 0, 10000 };
+        libusb_handle_events_timeout_completed(ctx, &tv, NULL);
+    }
+    int leaked = out->busy;
+    if (!leaked) {
+        libusb_free_transfer(out->transfer);
+    }
+    out->transfer = NULL;
+    out->busy = false;
+    return leaked;
+}
+
+#endif // USB_TRANSPORT_H